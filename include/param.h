@@ -3,7 +3,8 @@
 
 // System parameters
 
-#define NPROC        64  // maximum number of processes
+#define NPROC        64  // processes reported by getprocinfo(); see PROCPAGES
+#define PROCPAGES    10  // free pages per process when sizing the process table at boot
 #define KSTACKSIZE 4096  // size of per-process kernel stack
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
@@ -14,7 +15,24 @@
 #define ROOTDEV       1  // device number of file system root disk
 #define USERTOP  0xA0000 // end of user address space
 #define PHYSTOP  0x1000000 // use phys mem up to here as free pool
+#define KALLOCPOLICY "random" // page placement at boot: "random", "lifo" or "colour"
+#define NCOLOR        8  // page colours for the "colour" placement policy
+#define KMAGSIZE     32  // free pages each cpu keeps in front of the kalloc pools
+#define KZEROPAGES   16  // zeroed free pages each cpu keeps for kalloc_zeroed()
+#define KJUNK         0  // fill freed pages with junk to catch dangling refs
+#define BUDDYSTART 0x800000 // phys mem from here to PHYSTOP is kept by the buddy allocator
+#define BUDDYORDER   10  // largest buddy allocation: 2^10 pages
 #define MAXARG       32  // max exec arguments
 #define NLAYER        4  // number of mlfq priority queues
+#define NRTPRIO       8  // number of real-time priorities
+#define DLLIMIT     950  // share of each cpu deadline procs may reserve, per mille
+#define DLMAXPERIOD 100000  // longest deadline period, in ticks
+#define NGROUP        8  // number of cpu bandwidth groups
+#define IOBOOSTTOP    3  // highest mlfq level an I/O wakeup can raise a proc to
+#define IOBOOSTGAP   10  // ticks between two level raises of a proc on I/O wakeups
+#define WAITQBITS     6  // log2 of the number of sleep() wait queues
+#define DYNTICK       1  // program the local APIC timer one-shot for the next scheduling event
+#define SCHEDPOLICY "mlfq" // scheduling policy at boot: "mlfq", "rr" or "stride"
+#define SCHEDNAME    16  // maximum length of a scheduling policy name
 
 #endif // _PARAM_H_
@@ -3,6 +3,12 @@
 
 #include "param.h"
 
+// Scheduling classes (see setclass()).
+#define SCHED_NORMAL  0   // the MLFQ, or the policy chosen at boot
+#define SCHED_RT      1   // fixed priority, above every normal proc
+#define SCHED_BATCH   2   // runs only when nothing else wants the cpu
+#define SCHED_DEADLINE 3  // a reserved budget every period (see setdeadline())
+
 struct pstat {
   int inuse[NPROC]; // whether this slot of the process table is in use (1 or 0)
   int pid[NPROC];   // PID of each process
@@ -10,6 +16,64 @@ struct pstat {
   enum procstate state[NPROC];  // current state (e.g., SLEEPING or RUNNABLE) of each process
   int ticks[NPROC][4];  // number of ticks each process has accumulated at each of 4 priorities
   int wait_ticks[NPROC][4]; // number of ticks each process has waited before being scheduled
+  int cpu[NPROC];   // cpu each process is running on, or -1
+  int group[NPROC]; // bandwidth group of each process
+  int ioboosts[NPROC]; // times each process was woken from I/O ahead of its peers
+  int grp_quota[NGROUP];    // ticks each group may run per period, 0 for no limit
+  int grp_period[NGROUP];   // length of each group's period, in ticks
+  int grp_used[NGROUP];     // ticks each group has run in its current period
+  uint grp_usage[NGROUP];   // ticks each group has run in all
+  uint grp_throttled[NGROUP]; // periods in which each group ran out of quota
+};
+
+// One process, as reported by getprocs().
+struct procinfo {
+  int pid;                  // PID of the process
+  int priority;             // current priority level (0-3)
+  enum procstate state;     // current state (e.g., SLEEPING or RUNNABLE)
+  int ticks[4];             // ticks accumulated at each of 4 priorities
+  int wait_ticks[4];        // ticks waited at each of 4 priorities
+  int migrations;           // times it moved to a different cpu
+  int cpu;                  // cpu it is running on, or -1
+  int class;                // scheduling class
+  int missed;               // deadlines missed (SCHED_DEADLINE)
+  int ioboosts;             // times woken from I/O ahead of its peers
+};
+
+struct cpustat {
+  int ncpu;                 // number of cpus started
+  uint idle_ticks[NCPU];    // timer ticks each cpu has spent halted with nothing to run
+  uint migrations[NCPU];    // procs each cpu ran that had last run on another cpu
+  char policy[SCHEDNAME];   // scheduling policy in use
+};
+
+// Physical page allocator statistics, as reported by getmeminfo().
+struct memstat {
+  char policy[8];           // page placement policy (KALLOCPOLICY)
+  int freepages;            // free pages, in the pools and the cpus' magazines
+  int ncpu;                 // number of cpus started
+  uint allocs[NCPU];        // kalloc() calls on each cpu
+  uint hits[NCPU];          // of which the cpu's magazine had a page
+  uint frees[NCPU];         // kfree() calls on each cpu
+  uint spills[NCPU];        // of which found the cpu's magazine full
+  int zeroed[NCPU];         // zeroed free pages each cpu has ready
+  uint zallocs[NCPU];       // kalloc_zeroed() calls on each cpu
+  uint zhits[NCPU];         // of which the cpu had a zeroed page ready
+  uint locks;               // times a cpu took the pools' lock
+  uint contended;           // of which another cpu held it
+  int bfree[BUDDYORDER+1];  // free blocks of 2^k pages in the buddy allocator
+  int bpages;               // free pages in them
+  uint bfailed;             // kalloc_pages() calls failed with enough pages free
+};
+
+// MLFQ parameters, as read and set by setmlfq().
+struct mlfqparam {
+  int nlevel;               // levels in use, 1 to NLAYER; procs start at the top one
+  int slice[NLAYER];        // ticks a proc may run at each level before it is demoted (not level 0)
+  int rr[NLAYER];           // round-robin quantum at each level, in ticks
+  int aging;                // a proc waiting this many time slices of its level is boosted
+  int ioboost_top;          // highest level an I/O wakeup can raise a proc to
+  int ioboost_gap;          // ticks between two level raises of a proc on I/O wakeups
 };
 
 #endif // _PSTAT_H_
\ No newline at end of file
@@ -36,5 +36,17 @@
 #define SYS_sem_post        31
 #define SYS_sem_destroy     32
 #define SYS_getfilenum      33
+#define SYS_getcpuinfo      34
+#define SYS_getprocs        35
+#define SYS_setaffinity     36
+#define SYS_getaffinity     37
+#define SYS_setgang         38
+#define SYS_setsched        39
+#define SYS_setclass        40
+#define SYS_setdeadline     41
+#define SYS_setgroup        42
+#define SYS_setquota        43
+#define SYS_setmlfq         44
+#define SYS_getmeminfo      45
 
 #endif // _SYSCALL_H_
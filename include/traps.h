@@ -37,6 +37,7 @@
 #define IRQ_COM1         4
 #define IRQ_IDE         14
 #define IRQ_ERROR       19
+#define IRQ_WAKEUP      30      // IPI sent to rouse an idle cpu
 #define IRQ_SPURIOUS    31
 
 #endif // _TRAPS_H_
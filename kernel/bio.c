@@ -131,7 +131,7 @@ brelse(struct buf *b)
   bcache.head.next = b;
 
   b->flags &= ~B_BUSY;
-  wakeup(b);
+  wakeone(b);  // the next bget() waiter takes b
 
   release(&bcache.lock);
 }
@@ -5,12 +5,19 @@ struct buf;
 struct context;
 struct file;
 struct inode;
+struct kcache;
 struct pipe;
 struct proc;
+struct runq;
+struct schedops;
 struct spinlock;
 struct stat;
 
 struct pstat; // Added by Roxin Liu for MLFQ
+struct cpustat;
+struct procinfo;
+struct mlfqparam;
+struct memstat;
 
 // bio.c
 void            binit(void);
@@ -68,6 +75,17 @@ void            ioapicinit(void);
 char*           kalloc(void);
 void            kfree(char*);
 void            kinit(void);
+int             kfreepages(void);
+char*           kalloc_zeroed(void);
+int             kzero(void);
+char*           kalloc_pages(int);
+void            kfree_pages(char*, int);
+int             getmeminfo(struct memstat*);
+
+// kcache.c
+void            kcacheinit(struct kcache*, char*, uint);
+void*           kcachealloc(struct kcache*);
+void            kcachefree(struct kcache*, void*);
 
 // kbd.c
 void            kbdintr(void);
@@ -77,6 +95,11 @@ int             cpunum(void);
 extern volatile uint*    lapic;
 void            lapiceoi(void);
 void            lapicinit(int);
+void            lapicipi(int, int);
+void            lapicarm(uint);
+uint            lapicticks(void);
+extern int      dyntick;
+extern uint     tsctick;
 void            lapicstartap(uchar, uint);
 void            microdelay(int);
 
@@ -102,14 +125,20 @@ void            exit(void);
 int             fork(void);
 int             growproc(int);
 int             kill(int);
+struct proc*    pidlookup(int);
 void            pinit(void);
 void            procdump(void);
+void            ptable_lock(void);
+void            ptable_unlock(void);
 void            scheduler(void) __attribute__((noreturn));
 void            sched(void);
+int             schedtick(void);
 void            sleep(void*, struct spinlock*);
+void            sleepio(void*, struct spinlock*);
 void            userinit(void);
 int             wait(void);
 void            wakeup(void*);
+void            wakeone(void*);
 void            yield(void);
 int             clone(void(*)(void*, void*), void*, void*, void*);
 int             join(void**);
@@ -123,6 +152,37 @@ int             sem_wait(int);
 int             sem_post(int);
 int             sem_destroy(int);
 int		        getfilenum(int);
+int             getcpuinfo(struct cpustat*);
+int             getprocs(int, struct procinfo*, int);
+int             setaffinity(int, int);
+int             getaffinity(int);
+int             setgang(int);
+int             setsched(char*);
+int             setclass(int, int, int);
+int             setdeadline(int, int, int);
+int             throttle(void);
+int             setgroup(int, int);
+int             setquota(int, int, int);
+int             setmlfq(struct mlfqparam*, struct mlfqparam*);
+
+// sched.c
+extern struct schedops *schedops;
+void            rq_insert(struct runq*, struct proc*, struct proc*);
+void            rq_append(struct runq*, struct proc*);
+void            rq_push(struct runq*, struct proc*);
+void            rq_remove(struct runq*, struct proc*);
+struct proc*    rq_highest(struct runq*);
+int             rq_level(struct proc*);
+struct schedops* classops(struct proc*);
+void            dl_tick(struct runq*);
+void            schedclass(struct proc*, int, int);
+struct schedops* schedlookup(char*);
+extern int      ioboost_top;
+extern int      ioboost_gap;
+void            mlfq_get(struct mlfqparam*);
+int             mlfq_check(struct mlfqparam*);
+void            mlfq_set(struct mlfqparam*);
+void            schedinit(void);
 
 // swtch.S
 void            swtch(struct context**, struct context*);
@@ -161,6 +221,9 @@ void            idtinit(void);
 extern uint     ticks;
 void            tvinit(void);
 extern struct spinlock tickslock;
+void            tickupdate(void);
+void            tickalarm(uint);
+uint            tickalarmin(void);
 
 // uart.c
 void            uartinit(void);
@@ -181,6 +244,7 @@ int             loaduvm(pde_t*, char*, struct inode*, uint, uint);
 pde_t*          copyuvm(pde_t*, uint);
 void            switchuvm(struct proc*);
 void            switchkvm(void);
+void            switchkstack(struct proc*);
 int             copyout(pde_t*, uint, void*, uint);
 
 // number of elements in fixed-size array
@@ -273,7 +273,7 @@ iunlock(struct inode *ip)
 
   acquire(&icache.lock);
   ip->flags &= ~I_BUSY;
-  wakeup(ip);
+  wakeone(ip);  // the next ilock() waiter takes ip
   release(&icache.lock);
 }
 
@@ -147,7 +147,7 @@ iderw(struct buf *b)
   // Wait for request to finish.
   // Assuming will not sleep too long: ignore proc->killed.
   while((b->flags & (B_VALID|B_DIRTY)) != B_VALID){
-    sleep(b, &idelock);
+    sleepio(b, &idelock);
   }
 
   release(&idelock);
@@ -1,41 +1,247 @@
 // Physical memory allocator, intended to allocate
 // memory for user processes, kernel stacks, page table pages,
 // and pipe buffers. Allocates 4096-byte pages.
+//
+// Free pages are kept in pools, arrays of page addresses, so the
+// page to hand out can be picked by index and removed in constant
+// time by moving the last one into its slot.  Which page is picked
+// is the placement policy, chosen at boot (KALLOCPOLICY in param.h):
+//   "random"  any free page, at random (Xorshift), to scatter pages
+//   "lifo"    the page freed last, whose lines may still be cached
+//   "colour"  one pool per page colour (page number mod NCOLOR),
+//             taken from in turn, so consecutive pages do not
+//             compete for the same sets of a physically indexed cache
+//
+// In front of the pools, every cpu keeps a magazine of up to
+// KMAGSIZE free pages of its own, under a lock of its own that
+// other cpus only take when memory runs out.  kalloc() refills an
+// empty magazine with half that many pages from the pools, and
+// kfree() spills the older half of a full one back, so most calls
+// take no shared lock.  Before failing, kalloc() drains the other
+// cpus' magazines and zeroed pages back into the pools (see
+// kdrain()), so it only fails when no page is free anywhere.
+//
+// Page tables and fresh user pages must start out zeroed.  A cpu
+// with nothing to run zeroes up to KZEROPAGES free pages of its own
+// (see kzero()), and kalloc_zeroed() hands those out first, so the
+// zeroing is mostly done off the critical path.  Freed pages are
+// only filled with junk, to catch dangling refs, when KJUNK is set.
+//
+// Memory from BUDDYSTART to PHYSTOP is kept by a buddy allocator
+// instead, for kalloc_pages(): blocks of 2^k pages, k up to
+// BUDDYORDER, aligned to their size, split to fit a request and
+// merged with their buddy again when both are free.  The pools
+// borrow single pages from it only when they run out; kfree()
+// puts those in the magazine like any other, and they go back to
+// the buddy allocator rather than the pools when spilled.  kinit()
+// checks the buddy allocator before anything else uses it (see
+// bdcheck()).
 
 #include "types.h"
 #include "defs.h"
 #include "param.h"
 #include "mmu.h"
 #include "spinlock.h"
+#include "x86.h"
+#include "proc.h"
+#include "pstat.h"
 #include "rand.h"
 
-struct run {
-  struct run *next;
+#define NFRAME (PHYSTOP / PGSIZE)
+
+enum { KALLOC_RANDOM, KALLOC_LIFO, KALLOC_COLOUR };
+
+static char *policies[] = {
+[KALLOC_RANDOM]  "random",
+[KALLOC_LIFO]    "lifo",
+[KALLOC_COLOUR]  "colour",
+};
+
+struct pool {
+  char **page;   // free pages; kfree() appends
+  int n;         // number of free pages
+  int size;      // room in page
 };
 
 struct {
   struct spinlock lock;
-  struct run *freelist;
+  int policy;
+  int ncolor;    // pools in use: NCOLOR under "colour", else 1
+  int color;     // pool the next page is taken from under "colour"
+  int nfree;     // free pages in all pools
+  uint seed;     // xv6_rand_r() state for "random"
+  struct pool pool[NCOLOR];
+  uint locks;    // times lock was taken
+  uint contended;  // of which it was held by another cpu
 } kmem;
 
+// A cpu's own free pages.
+struct kmag {
+  struct spinlock lock;  // taken by others only in kdrain()
+  char *page[KMAGSIZE];
+  int n;
+  uint allocs;   // kalloc() calls
+  uint hits;     // of which the magazine had a page
+  uint frees;    // kfree() calls
+  uint spills;   // of which found the magazine full
+  char *zero[KZEROPAGES];  // zeroed free pages
+  int nzero;
+  uint seed;     // xv6_rand_r() state for "random", for this cpu alone
+  uint zallocs;  // kalloc_zeroed() calls
+  uint zhits;    // of which had a zeroed page
+};
+
+static struct kmag kmags[NCPU];
+
+static void poolput(char*);
+
+// Slots of the pools; no colour has more than NFRAME/NCOLOR+1 pages.
+static char *slots[NFRAME + NCOLOR];
+
+#define NBFRAME ((PHYSTOP - BUDDYSTART) / PGSIZE)
+
+// A free block of the buddy allocator, kept in its first page.
+struct bblock {
+  struct bblock *next;
+  struct bblock *prev;
+};
+
+struct {
+  struct spinlock lock;
+  struct bblock free[BUDDYORDER+1];  // free blocks of each order
+  int nfree[BUDDYORDER+1];
+  uchar order[NBFRAME];  // 1 + order of the free block at each page, else 0
+  int npage;             // free pages in all blocks
+  uint failed;           // kalloc_pages() calls failed with enough pages free
+} buddy;
+
+static void bdput(char*, int);
+static void bdcheck(void);
+
 extern char end[]; // first address after kernel loaded from ELF file
 
 /* Variables created by Roxin Liu: */
-char *allocated[512]; // History: The addresses of all allocated page in order
-int num_alloc = 0;  // the number of allocated pages
-int size_freelist = 0;  // number of free pages in freelist
+char *allocated[512]; // History: the addresses of the last pages allocated, a ring
+uint num_alloc = 0;  // the number of allocated pages
 
 // Initialize free list of physical pages.
 void
 kinit(void)
 {
   char *p;
+  int i;
 
   initlock(&kmem.lock, "kmem");
+  kmem.seed = 1;
+  for(i = 0; i < NCPU; i++){
+    initlock(&kmags[i].lock, "kmag");
+    kmags[i].seed = i + 2;
+  }
+  for(i = 0; i < NELEM(policies); i++)
+    if(strncmp(policies[i], KALLOCPOLICY, sizeof(KALLOCPOLICY)) == 0)
+      break;
+  if(i == NELEM(policies))
+    panic("kinit policy");
+  kmem.policy = i;
+  kmem.ncolor = i == KALLOC_COLOUR ? NCOLOR : 1;
+  for(i = 0; i < kmem.ncolor; i++){
+    kmem.pool[i].size = NFRAME / kmem.ncolor + 1;
+    kmem.pool[i].page = slots + i * kmem.pool[i].size;
+  }
+
+  initlock(&buddy.lock, "buddy");
+  for(i = 0; i <= BUDDYORDER; i++)
+    buddy.free[i].next = buddy.free[i].prev = &buddy.free[i];
+  if(BUDDYSTART % (PGSIZE << BUDDYORDER) || (char*)BUDDYSTART < end ||
+     (PHYSTOP - BUDDYSTART) % (PGSIZE << BUDDYORDER))
+    panic("kinit buddy");
+
   p = (char*)PGROUNDUP((uint)end);
-  for(; p + PGSIZE <= (char*)PHYSTOP; p += PGSIZE) 
-    kfree(p);
-  
+  for(; p + PGSIZE <= (char*)PHYSTOP; p += PGSIZE){
+#if KJUNK
+    memset(p, 1, PGSIZE);
+#endif
+    if((uint)p < BUDDYSTART)
+      poolput(p);
+    else if(((uint)p - BUDDYSTART) % (PGSIZE << BUDDYORDER) == 0)
+      bdput(p, BUDDYORDER);
+  }
+  bdcheck();
+}
+
+// Record v as the page allocated last, for dump_allocated().
+// The history is shared by all cpus; each takes its own slot.
+static void
+kallocated(char *v)
+{
+  uint i;
+
+  i = __sync_fetch_and_add(&num_alloc, 1);
+  allocated[i % NELEM(allocated)] = v;
+}
+
+// Take kmem.lock, counting the times another cpu had it.
+static void
+kmemlock(void)
+{
+  int busy;
+
+  busy = kmem.lock.locked;
+  acquire(&kmem.lock);
+  kmem.locks++;
+  if(busy)
+    kmem.contended++;
+}
+
+// Put page v in the pool of its colour, or give it back to the
+// buddy allocator if it is one of its pages.
+// Caller must hold kmem.lock, except in kinit().
+static void
+poolput(char *v)
+{
+  struct pool *pl;
+
+  if((uint)v >= BUDDYSTART){
+    bdput(v, 0);
+    return;
+  }
+  pl = &kmem.pool[(uint)v / PGSIZE % kmem.ncolor];
+  if(pl->n == pl->size)
+    panic("kfree: double free");
+  pl->page[pl->n++] = v;
+  kmem.nfree++;
+}
+
+// Take a page out of the pools as the placement policy says,
+// or from the buddy allocator if they are empty.
+// Caller must hold kmem.lock.
+static char*
+pooltake(void)
+{
+  struct pool *pl;
+  char *v;
+  int i;
+
+  if(kmem.nfree == 0)
+    return kalloc_pages(0);
+
+  pl = &kmem.pool[0];
+  if(kmem.policy == KALLOC_COLOUR){
+    while(kmem.pool[kmem.color].n == 0)
+      kmem.color = (kmem.color + 1) % NCOLOR;
+    pl = &kmem.pool[kmem.color];
+    kmem.color = (kmem.color + 1) % NCOLOR;
+  }
+  if(kmem.policy == KALLOC_RANDOM)
+    i = xv6_rand_r(&kmem.seed) % pl->n;
+  else
+    i = pl->n - 1;
+
+  // Take page i out, moving the last page into its slot.
+  v = pl->page[i];
+  pl->page[i] = pl->page[--pl->n];
+  kmem.nfree--;
+  return v;
 }
 
 // Free the page of physical memory pointed at by v,
@@ -45,20 +251,244 @@ kinit(void)
 void
 kfree(char *v)
 {
-  struct run *r;
+  struct kmag *m;
+  int i, half;
 
-  if((uint)v % PGSIZE || v < end || (uint)v >= PHYSTOP) 
+  if((uint)v % PGSIZE || v < end || (uint)v >= PHYSTOP)
     panic("kfree");
 
+#if KJUNK
   // Fill with junk to catch dangling refs.
   memset(v, 1, PGSIZE);
+#endif
 
-  acquire(&kmem.lock);
-  r = (struct run*)v;
-  r->next = kmem.freelist;
-  kmem.freelist = r;
-  size_freelist += 1;
+  pushcli();
+  m = &kmags[cpu - cpus];
+  acquire(&m->lock);
+  m->frees++;
+  if(m->n == KMAGSIZE){
+    // Spill the pages freed longest ago; the rest may still be cached.
+    m->spills++;
+    half = KMAGSIZE / 2;
+    kmemlock();
+    for(i = 0; i < half; i++)
+      poolput(m->page[i]);
+    release(&kmem.lock);
+    memmove(m->page, m->page + half, (KMAGSIZE - half) * sizeof(m->page[0]));
+    m->n -= half;
+  }
+  m->page[m->n++] = v;
+  release(&m->lock);
+  popcli();
+}
+
+// Number of free pages, in the pools and the magazines.
+int
+kfreepages(void)
+{
+  int i, n;
+
+  n = kmem.nfree + buddy.npage;
+  for(i = 0; i < NCPU; i++)
+    n += kmags[i].n + kmags[i].nzero;
+  return n;
+}
+
+// Add block v of 2^k pages to the free blocks.
+// Caller must hold buddy.lock.
+static void
+bdlink(char *v, int k)
+{
+  struct bblock *b = (struct bblock*)v;
+
+  b->next = buddy.free[k].next;
+  b->prev = &buddy.free[k];
+  b->next->prev = b;
+  buddy.free[k].next = b;
+  buddy.order[(v - (char*)BUDDYSTART) / PGSIZE] = k + 1;
+  buddy.nfree[k]++;
+}
+
+// Take block v of 2^k pages off the free blocks.
+// Caller must hold buddy.lock.
+static void
+bdunlink(char *v, int k)
+{
+  struct bblock *b = (struct bblock*)v;
+
+  b->prev->next = b->next;
+  b->next->prev = b->prev;
+  buddy.order[(v - (char*)BUDDYSTART) / PGSIZE] = 0;
+  buddy.nfree[k]--;
+}
+
+// Free block v of 2^k pages, merging it with its buddy, the
+// other half of the block of 2^(k+1) pages, for as long as that
+// is free too.
+static void
+bdput(char *v, int k)
+{
+  int i, j;
+
+  i = (v - (char*)BUDDYSTART) / PGSIZE;
+  acquire(&buddy.lock);
+  if(buddy.order[i] != 0)
+    panic("kfree_pages: double free");
+  buddy.npage += 1 << k;
+  for(; k < BUDDYORDER; k++){
+    j = i ^ (1 << k);
+    if(buddy.order[j] != k + 1)
+      break;
+    bdunlink((char*)BUDDYSTART + j * PGSIZE, k);
+    i &= ~(1 << k);
+  }
+  bdlink((char*)BUDDYSTART + i * PGSIZE, k);
+  release(&buddy.lock);
+}
+
+// Allocate 2^order physically contiguous pages, aligned to their
+// size, for order 0 to BUDDYORDER.  Splits the smallest free
+// block big enough, keeping the halves it does not need.
+// Returns 0 if there is none.
+char*
+kalloc_pages(int order)
+{
+  char *v;
+  int k;
+
+  if(order < 0 || order > BUDDYORDER)
+    return 0;
+
+  acquire(&buddy.lock);
+  for(k = order; k <= BUDDYORDER; k++)
+    if(buddy.nfree[k] > 0)
+      break;
+  if(k > BUDDYORDER){
+    if(buddy.npage >= 1 << order)
+      buddy.failed++;
+    release(&buddy.lock);
+    return 0;
+  }
+  v = (char*)buddy.free[k].next;
+  bdunlink(v, k);
+  while(k > order){
+    k--;
+    bdlink(v + (PGSIZE << k), k);
+  }
+  buddy.npage -= 1 << order;
+  release(&buddy.lock);
+  return v;
+}
+
+// Check the buddy allocator while all its memory is free: take a
+// block of every order and then the rest one page at a time, give
+// back the odd pages, which must not merge with anything, then
+// the blocks in mixed order and the even pages, and check that
+// everything merged back into blocks of BUDDYORDER.  Panics if
+// not.
+static void
+bdcheck(void)
+{
+  char *blk[BUDDYORDER+1], *list[2], *v, *next;
+  int k, n[2], total;
+
+  total = buddy.npage;
+  for(k = 0; k <= BUDDYORDER; k++)
+    if((blk[k] = kalloc_pages(k)) == 0 ||
+       ((uint)blk[k] - BUDDYSTART) % (PGSIZE << k))
+      panic("bdcheck order");
+
+  // The pages left, in two lists by the parity of their number,
+  // chained through their first word.
+  list[0] = list[1] = 0;
+  n[0] = n[1] = 0;
+  while((v = kalloc_pages(0)) != 0){
+    k = (uint)v / PGSIZE % 2;
+    *(char**)v = list[k];
+    list[k] = v;
+    n[k]++;
+  }
+  if(buddy.npage != 0 || n[0] + n[1] + (2 << BUDDYORDER) - 1 != total)
+    panic("bdcheck count");
+
+  for(v = list[1]; v != 0; v = next){
+    next = *(char**)v;
+    bdput(v, 0);
+  }
+  if(buddy.nfree[0] != n[1])
+    panic("bdcheck merged");
+  for(k = BUDDYORDER - (BUDDYORDER % 2 == 0); k >= 0; k -= 2)
+    bdput(blk[k], k);
+  for(k = 0; k <= BUDDYORDER; k += 2)
+    bdput(blk[k], k);
+  for(v = list[0]; v != 0; v = next){
+    next = *(char**)v;
+    bdput(v, 0);
+  }
+
+  for(k = 0; k < BUDDYORDER; k++)
+    if(buddy.nfree[k] != 0)
+      panic("bdcheck split");
+  if(buddy.npage != total || buddy.nfree[BUDDYORDER] << BUDDYORDER != total)
+    panic("bdcheck free");
+}
+
+// Free the 2^order pages at v, which should have been
+// returned by kalloc_pages(order).
+void
+kfree_pages(char *v, int order)
+{
+  if(order < 0 || order > BUDDYORDER || (uint)v < BUDDYSTART ||
+     (uint)v + (PGSIZE << order) > PHYSTOP ||
+     ((uint)v - BUDDYSTART) % (PGSIZE << order))
+    panic("kfree_pages");
+
+#if KJUNK
+  memset(v, 1, PGSIZE << order);
+#endif
+  bdput(v, order);
+}
+
+// Refill this cpu's empty magazine m with half of KMAGSIZE pages
+// from the pools, or else with one of its zeroed pages.  Returns
+// the number of pages in m.  Caller must hold m->lock.
+static int
+kmagfill(struct kmag *m)
+{
+  char *v;
+
+  kmemlock();
+  while(m->n < KMAGSIZE / 2 && (v = pooltake()) != 0)
+    m->page[m->n++] = v;
   release(&kmem.lock);
+  if(m->n == 0 && m->nzero > 0)
+    m->page[m->n++] = m->zero[--m->nzero];
+  return m->n;
+}
+
+// Give the free pages of every other cpu's magazine, zeroed ones
+// included, back to the pools, for kalloc() when they run dry.
+// Caller must have interrupts off and hold no magazine lock,
+// lest two cpus draining at once wait for each other's.
+static void
+kdrain(void)
+{
+  struct kmag *m;
+
+  for(m = kmags; m < kmags + ncpu; m++){
+    if(m == &kmags[cpu - cpus])
+      continue;
+    acquire(&m->lock);
+    if(m->n + m->nzero > 0){
+      kmemlock();
+      while(m->n > 0)
+        poolput(m->page[--m->n]);
+      while(m->nzero > 0)
+        poolput(m->zero[--m->nzero]);
+      release(&kmem.lock);
+    }
+    release(&m->lock);
+  }
 }
 
 /* Edited by Roxin Liu: */
@@ -69,52 +499,157 @@ kfree(char *v)
 char*
 kalloc(void)
 {
-  struct run *r; // points the page to be allocated
+  struct kmag *m;
+  char *v;
+  int i;
 
-  acquire(&kmem.lock);
-  
-  r = kmem.freelist; // head of the freelist
-  int i, rd = xv6_rand() % size_freelist;
-    // rd is the index of the page to be allocated in freelist
-  
-  // Case when first page is allocated:
-  if (rd == 0)
-    kmem.freelist = r->next; // r->next becomes the head
-
-  // Case when the page is else where:
-  else 
-  {
-    // Traverse through the freelist to find the page:
-    struct run *r_prev;
-    for (i=0; i<rd; i++)
-    {
-      r_prev = r;
-      r = r -> next;
+  pushcli();
+  m = &kmags[cpu - cpus];
+  acquire(&m->lock);
+  m->allocs++;
+  if(m->n > 0)
+    m->hits++;
+  else if(kmagfill(m) == 0){
+    // The last free pages may be in other cpus' magazines.
+    release(&m->lock);
+    kdrain();
+    acquire(&m->lock);
+    if(m->n == 0 && kmagfill(m) == 0){
+      release(&m->lock);
+      popcli();
+      return 0;
     }
-    // Remove r from the freelist
-    r_prev -> next = r -> next;
   }
 
-  release(&kmem.lock);
+  // Random placement picks among the magazine's pages too.
+  i = m->n - 1;
+  if(kmem.policy == KALLOC_RANDOM)
+    i = xv6_rand_r(&m->seed) % m->n;
+  v = m->page[i];
+  m->page[i] = m->page[--m->n];
+  release(&m->lock);
+  popcli();
+
+  kallocated(v);
+  return v;
+}
+
+// Allocate one zeroed page, like kalloc().
+// Takes a page this cpu zeroed while idle if it has one.
+char*
+kalloc_zeroed(void)
+{
+  struct kmag *m;
+  char *v;
+
+  pushcli();
+  m = &kmags[cpu - cpus];
+  acquire(&m->lock);
+  m->zallocs++;
+  if(m->nzero > 0){
+    m->zhits++;
+    v = m->zero[--m->nzero];
+    release(&m->lock);
+    popcli();
+    kallocated(v);
+    return v;
+  }
+  release(&m->lock);
+  popcli();
+
+  if((v = kalloc()) != 0)
+    memset(v, 0, PGSIZE);
+  return v;
+}
+
+// Zero a free page for kalloc_zeroed(), while this cpu has
+// nothing to run; see scheduler().  Returns 0 if the cpu already
+// has KZEROPAGES zeroed pages, or there are no free pages left.
+int
+kzero(void)
+{
+  struct kmag *m;
+  char *v;
+
+  pushcli();
+  m = &kmags[cpu - cpus];
+  acquire(&m->lock);
+  if(m->nzero == KZEROPAGES){
+    release(&m->lock);
+    popcli();
+    return 0;
+  }
+  if(m->n > 0)
+    v = m->page[--m->n];
+  else {
+    kmemlock();
+    v = pooltake();
+    release(&kmem.lock);
+  }
+  release(&m->lock);
+  popcli();
+  if(v == 0)
+    return 0;
 
-  allocated[num_alloc] = (char*)r;
-  num_alloc += 1;
-  size_freelist -= 1;
-  
-  return (char*)r;
+  // With interrupts on: the page is no one else's meanwhile.
+  memset(v, 0, PGSIZE);
+
+  // Only this cpu adds zeroed pages, though kdrain() may have
+  // taken some meanwhile.
+  pushcli();
+  acquire(&m->lock);
+  m->zero[m->nzero++] = v;
+  release(&m->lock);
+  popcli();
+  return 1;
 }
 
 // Store and return the addresses of the last n pages allocated,
 // where n = numframes.
-int 
-dump_allocated(int *frames, int numframes) 
+int
+dump_allocated(int *frames, int numframes)
 {
+  int i;
+
   // Invalid numframes:
-  if (numframes > num_alloc)
+  if (numframes < 0 || numframes > num_alloc || numframes > NELEM(allocated))
     return -1;
 
-  for (int i=0; i<numframes; i++)
-    frames[i] = (int)allocated[num_alloc-1-i];
+  for (i=0; i<numframes; i++)
+    frames[i] = (int)allocated[(num_alloc-1-i) % NELEM(allocated)];
 
   return 0;
 }
+
+// Store the allocator's statistics in ms.
+int
+getmeminfo(struct memstat *ms)
+{
+  struct kmag *m;
+  int i;
+
+  if (ms == NULL)
+    return -1;
+
+  safestrcpy(ms -> policy, policies[kmem.policy], sizeof(ms -> policy));
+  ms -> freepages = kfreepages();
+  ms -> ncpu = ncpu;
+  for (i = 0; i < ncpu; i++)
+  {
+    m = &kmags[i];
+    ms -> allocs[i] = m -> allocs;
+    ms -> hits[i] = m -> hits;
+    ms -> frees[i] = m -> frees;
+    ms -> spills[i] = m -> spills;
+    ms -> zeroed[i] = m -> nzero;
+    ms -> zallocs[i] = m -> zallocs;
+    ms -> zhits[i] = m -> zhits;
+  }
+  ms -> locks = kmem.locks;
+  ms -> contended = kmem.contended;
+  for (i = 0; i <= BUDDYORDER; i++)
+    ms -> bfree[i] = buddy.nfree[i];
+  ms -> bpages = buddy.npage;
+  ms -> bfailed = buddy.failed;
+  return 0;
+}
@@ -0,0 +1,86 @@
+// Kernel object caches.  Hand out fixed-size objects carved
+// from pages obtained with kalloc(), for kernel structures that
+// are allocated on demand instead of from a static array.
+// Pages stay with their cache once carved up.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "kcache.h"
+
+struct kobj {
+  struct kobj *next;
+};
+
+void
+kcacheinit(struct kcache *kc, char *name, uint size)
+{
+  size = (size + 3) & ~3;
+  if(size < sizeof(struct kobj) || size > PGSIZE)
+    panic("kcacheinit");
+  initlock(&kc->lock, name);
+  kc->name = name;
+  kc->size = size;
+  kc->free = 0;
+  kc->npage = 0;
+  kc->nfree = 0;
+}
+
+// Carve a new page into free objects.
+// Caller must hold kc->lock.  Returns -1 if out of memory.
+static int
+kcachegrow(struct kcache *kc)
+{
+  struct kobj *o;
+  char *pg, *v;
+
+  if((pg = kalloc()) == 0)
+    return -1;
+  for(v = pg; v + kc->size <= pg + PGSIZE; v += kc->size){
+    o = (struct kobj*)v;
+    o->next = kc->free;
+    kc->free = o;
+    kc->nfree++;
+  }
+  kc->npage++;
+  return 0;
+}
+
+// Allocate one zeroed object from kc.
+// Returns 0 if the memory cannot be allocated.
+void*
+kcachealloc(struct kcache *kc)
+{
+  struct kobj *o;
+
+  acquire(&kc->lock);
+  if(kc->free == 0 && kcachegrow(kc) < 0){
+    release(&kc->lock);
+    return 0;
+  }
+  o = kc->free;
+  kc->free = o->next;
+  kc->nfree--;
+  release(&kc->lock);
+
+  memset(o, 0, kc->size);
+  return o;
+}
+
+// Return an object allocated from kc.
+void
+kcachefree(struct kcache *kc, void *v)
+{
+  struct kobj *o = v;
+
+  // Fill with junk to catch dangling refs.
+  memset(o, 1, kc->size);
+
+  acquire(&kc->lock);
+  o->next = kc->free;
+  kc->free = o;
+  kc->nfree++;
+  release(&kc->lock);
+}
@@ -0,0 +1,16 @@
+#ifndef _KCACHE_H_
+#define _KCACHE_H_
+
+#include "spinlock.h"
+
+// A cache of fixed-size kernel objects (see kcache.c).
+struct kcache {
+  struct spinlock lock;
+  char *name;        // Name of cache, for debugging.
+  uint size;         // Size of each object in bytes.
+  struct kobj *free; // Free objects.
+  int npage;         // Pages taken from kalloc().
+  int nfree;         // Number of free objects.
+};
+
+#endif // _KCACHE_H_
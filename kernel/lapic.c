@@ -3,9 +3,11 @@
 
 #include "types.h"
 #include "defs.h"
+#include "param.h"
 #include "traps.h"
 #include "mmu.h"
 #include "x86.h"
+#include "proc.h"
 
 // Local APIC registers, divided by 4 for use as uint[] indices.
 #define ID      (0x0020/4)   // ID
@@ -38,7 +40,12 @@
 #define TCCR    (0x0390/4)   // Timer Current Count
 #define TDCR    (0x03E0/4)   // Timer Divide Configuration
 
+#define TICK     10000000     // Timer counts per clock tick
+#define MAXTICK  400          // Most ticks one TICR can hold
+
 volatile uint *lapic;  // Initialized in mp.c
+int dyntick;           // Timer is armed one-shot, see lapicarm()
+uint tsctick;          // TSC cycles per clock tick
 
 static void
 lapicw(int index, int value)
@@ -62,8 +69,29 @@ lapicinit(int c)
   // If xv6 cared more about precise timekeeping,
   // TICR would be calibrated using an external time source.
   lapicw(TDCR, X1);
-  lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
-  lapicw(TICR, 10000000); 
+#if DYNTICK
+  // With dynamic ticks the boot cpu times one tick against
+  // the TSC, which then keeps ticks for every cpu, and the
+  // scheduler arms each timer only for the next tick it
+  // has a use for.
+  if(c == mpbcpu()){
+    uint64 t0;
+
+    lapicw(TIMER, MASKED | (T_IRQ0 + IRQ_TIMER));
+    lapicw(TICR, TICK);
+    t0 = rdtsc();
+    while(lapic[TCCR] != 0)
+      ;
+    tsctick = rdtsc() - t0;
+    dyntick = tsctick != 0;
+  }
+  if(dyntick)
+    lapicw(TIMER, T_IRQ0 + IRQ_TIMER);
+#endif
+  if(!dyntick){
+    lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
+    lapicw(TICR, TICK);
+  }
 
   // Disable logical interrupt lines.
   lapicw(LINT0, MASKED);
@@ -94,6 +122,60 @@ lapicinit(int c)
   lapicw(TPR, 0);
 }
 
+// Send interrupt vector to the cpu whose local APIC id is apicid.
+void
+lapicipi(int apicid, int vector)
+{
+  if(!lapic)
+    return;
+  lapicw(ICRHI, apicid<<24);
+  lapicw(ICRLO, FIXED | ASSERT | vector);
+  while(lapic[ICRLO] & DELIVS)
+    ;
+}
+
+// Ticks the timer has crossed since the last call or
+// lapicarm(), counted from the tick boundaries a periodic
+// timer would have interrupted at.
+uint
+lapicticks(void)
+{
+  uint done, n;
+
+  if(!dyntick || cpu->tmr_init == 0)
+    return 0;
+  done = cpu->tmr_off + (cpu->tmr_init - lapic[TCCR]);
+  n = done / TICK - cpu->tmr_seen;
+  cpu->tmr_seen += n;
+  return n;
+}
+
+// Interrupt at the n'th tick boundary from now, keeping the
+// phase of the boundaries the timer was last armed with.
+// n == 0 stops the timer.
+void
+lapicarm(uint n)
+{
+  uint phase;
+
+  if(!dyntick)
+    return;
+  phase = 0;
+  if(cpu->tmr_init != 0)
+    phase = (cpu->tmr_off + (cpu->tmr_init - lapic[TCCR])) % TICK;
+  if(n == 0){
+    lapicw(TICR, 0);
+    cpu->tmr_init = 0;
+    return;
+  }
+  if(n > MAXTICK)
+    n = MAXTICK;
+  cpu->tmr_off = phase;
+  cpu->tmr_init = n*TICK - phase;
+  cpu->tmr_seen = 0;
+  lapicw(TICR, cpu->tmr_init);
+}
+
 int
 cpunum(void)
 {
@@ -9,6 +9,7 @@ KERNEL_OBJECTS := \
 	ide.o\
 	ioapic.o\
 	kalloc.o\
+	kcache.o\
 	kbd.o\
 	lapic.o\
 	main.o\
@@ -16,6 +17,7 @@ KERNEL_OBJECTS := \
 	picirq.o\
 	pipe.o\
 	proc.o\
+	sched.o\
 	spinlock.o\
 	string.o\
 	swtch.o\
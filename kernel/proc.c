@@ -5,30 +5,112 @@
 #include "x86.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "kcache.h"
+#include "traps.h"
 
 #include "pstat.h"
 
+// Cache affinity (see rq_select() and rq_pick()).
+#define AFFWINDOW  4  // ticks a proc's cache state is assumed to survive
+#define AFFWAIT    4  // ticks the head of a level may be passed over
+#define AFFSCAN    4  // procs of a level looked at for one that ran here
+
+// The process table holds every allocated proc, in pid order.
+// Procs come from proccache and are freed once reaped.
 struct {
   struct spinlock lock;
-  struct proc proc[NPROC];
+  struct proc *head;               // Oldest proc; circular through tbl_next
+  int nproc;                       // Number of procs in the table
+  int maxproc;                     // Table limit, set at boot from free memory
+  struct proc **pidhash;           // Live procs by pid, chained through pid_next
+  uint npidhash;                   // Chains in pidhash, a power of two
 } ptable;
 
+static struct kcache proccache;
+
 static struct proc *initproc;
 
 int nextpid = 1;
 extern void forkret(void);
 extern void trapret(void);
 
-static void wakeup1(void *chan);
+static void wakeup1(void *chan, int all);
+static void rq_sync(struct runq *rq, struct proc *p);
+static void schedarm(struct runq *rq, struct proc *p);
+static void sem_drop(struct proc *p);
+static struct runq* rq_lockproc(struct proc *p);
+static int grp_over(struct proc *p, uint *until);
+
+// Sleeping procs, hashed by the channel they sleep on so that
+// wakeup() only looks at the procs waiting on its channel.
+// Each queue is a circular doubly-linked FIFO through
+// p->wq_next/wq_prev, guarded by its own lock; p->chan and the
+// SLEEPING state of a proc only change under that lock.
+struct waitq {
+  struct spinlock lock;
+  struct proc *head;
+};
+static struct waitq waitq[1 << WAITQBITS];
 
 /* Key variables added by Roxin Liu: */
 
-// Variables for MLFQ: 
-static struct proc *mlfq[NLAYER][512];
-static int mlfq_size[NLAYER] = {0,0,0,0};
+// The run queues themselves live in each struct cpu (see proc.h),
+// and the scheduling policy in sched.c.
+
+// Co-schedule procs sharing a page table (see setgang()).
+static int gang;
+
+// Share of each cpu reserved by deadline procs (see setdeadline()),
+// per mille.  Protected by ptable.lock.
+static int dl_reserved[NCPU];
+
+// The share of a cpu a reservation of budget ticks every period
+// ticks takes, per mille, rounded up so none is free.
+static int
+dl_share(int budget, int period)
+{
+  return (budget * 1000 + period - 1) / period;
+}
+
+// The share of a cpu p reserves, per mille.
+static int
+dl_util(struct proc *p)
+{
+  return dl_share(p -> dl_budget, p -> dl_period);
+}
+
+// Choose the started cpu in mask with the least reserved that has
+// room for share more within DLLIMIT, or return 0 if none has.
+// Caller must hold ptable.lock.
+static struct cpu*
+dl_place(int share, int mask)
+{
+  struct cpu *c, *best = 0;
+  int i;
+
+  for (c = cpus; c < cpus+ncpu; c++)
+  {
+    i = c - cpus;
+    if (c -> booted && ((mask >> i) & 1) &&
+        dl_reserved[i] + share <= DLLIMIT &&
+        (best == 0 || dl_reserved[i] < dl_reserved[best - cpus]))
+      best = c;
+  }
+  return best;
+}
 
-int limit_total[NLAYER] = {64, 32, 16, 8};
-int limit_rr[NLAYER] = {64, 4, 2, 1};
+// CPU bandwidth groups (see setquota()).  Every proc is in one,
+// group 0 unless moved by setgroup(); group 0 has no quota.
+struct group {
+  struct spinlock lock;
+  int quota;                   // Ticks its procs may run per period, 0 for no limit
+  int period;                  // Length of a period, in ticks
+  uint start;                  // ticks when the current period began
+  int used;                    // Ticks its procs have run this period
+  uint usage;                  // Ticks its procs have run in all
+  uint throttled;              // Periods in which it ran out of quota
+};
+static struct group groups[NGROUP];
 
 // Variables for Semaphores:
 struct semaphore {
@@ -37,6 +119,9 @@ struct semaphore {
   int used;
   //void* channel;
   struct spinlock splock;
+  int mutex;           // Created with a count of 1: track its holder
+  struct proc *holder; // Mutex: proc that last took it, until it is posted
+  int pi;              // Mutex: highest run queue level of its waiters
 };
 struct semaphore sem_list[NUM_SEMAPHORES];
 int num_sem = 0;
@@ -46,12 +131,461 @@ struct spinlock lock_semlist;
 void
 pinit(void)
 {
+  struct cpu *c;
+  struct group *g;
+  int order;
+
+  struct waitq *wq;
+
   initlock(&ptable.lock, "ptable");
+  kcacheinit(&proccache, "proc", sizeof(struct proc));
+  schedinit();
+  ptable.maxproc = kfreepages() / PROCPAGES;
+  if(ptable.maxproc < NPROC)
+    ptable.maxproc = NPROC;
+
+  // A chain for every proc the table may hold, so that
+  // pidlookup() stays short however big that is: pids are
+  // handed out in turn, and live ones spread over the chains.
+  order = 0;
+  ptable.npidhash = PGSIZE / sizeof(ptable.pidhash[0]);
+  while(ptable.npidhash < ptable.maxproc && order < BUDDYORDER){
+    ptable.npidhash *= 2;
+    order++;
+  }
+  if((ptable.pidhash = (struct proc**)kalloc_pages(order)) == 0)
+    panic("pinit pidhash");
+  memset(ptable.pidhash, 0, PGSIZE << order);
+  for(c = cpus; c < cpus+NCPU; c++)
+    initlock(&c->rq.lock, "runq");
+  for(wq = waitq; wq < waitq + (1 << WAITQBITS); wq++)
+    initlock(&wq->lock, "waitq");
+  for(g = groups; g < groups + NGROUP; g++)
+    initlock(&g->lock, "group");
+}
+
+// The wait queue for chan.
+static struct waitq*
+wq_hash(void *chan)
+{
+  return &waitq[((uint)chan * 0x9E3779B1) >> (32 - WAITQBITS)];
+}
+
+// Append p to the tail of wq.  Caller must hold wq->lock.
+static void
+wq_append(struct waitq *wq, struct proc *p)
+{
+  struct proc *head = wq->head;
+
+  if(head == 0){
+    p->wq_next = p;
+    p->wq_prev = p;
+    wq->head = p;
+  } else {
+    p->wq_next = head;
+    p->wq_prev = head->wq_prev;
+    head->wq_prev->wq_next = p;
+    head->wq_prev = p;
+  }
+}
+
+// Unlink p from wq.  Caller must hold wq->lock.
+static void
+wq_remove(struct waitq *wq, struct proc *p)
+{
+  if(p->wq_next == p)
+    wq->head = 0;
+  else {
+    p->wq_prev->wq_next = p->wq_next;
+    p->wq_next->wq_prev = p->wq_prev;
+    if(wq->head == p)
+      wq->head = p->wq_next;
+  }
+  p->wq_next = 0;
+  p->wq_prev = 0;
+}
+
+// Number of procs queued on or running on c.
+// Read without locks, so only good as a placement hint.
+static int
+rq_load(struct cpu *c)
+{
+  return c->rq.nrun + (c->proc != 0);
+}
+
+// May p run on c?  See setaffinity().
+static int
+allowed(struct proc *p, struct cpu *c)
+{
+  if(p->class == SCHED_DEADLINE)
+    return c == p->dl_cpu;
+  return (p->affinity >> (c - cpus)) & 1;
+}
+
+// Is p one of a group of procs sharing a page table (a process
+// and its clone() threads) that gang scheduling runs together?
+// Reads p->threads without ptable.lock, so only a hint.
+static int
+ganged(struct proc *p)
+{
+  return gang && (p->isthread || p->threads != 0);
+}
+
+// Highest level of a proc sharing p's page table that is
+// running on another cpu, or -1 if there is none.  Reads other
+// cpus' state without locks, so only good as a hint; procs
+// are never unmapped (see kcachefree()), so a stale c->proc
+// is safe to look at.
+static int
+gang_level(struct proc *p)
+{
+  struct cpu *c;
+  struct proc *q;
+  int lvl = -1;
+
+  for(c = cpus; c < cpus+ncpu; c++)
+    if(c != cpu && (q = c->proc) != 0 && q != p &&
+       q->pgdir == p->pgdir && rq_level(q) > lvl)
+      lvl = rq_level(q);
+  return lvl;
+}
+
+// Load of c as seen by p: its queued and running procs, plus
+// one if gang scheduling would keep p from running alongside
+// a sibling already running on c.
+static int
+rq_cost(struct cpu *c, struct proc *p)
+{
+  struct proc *q;
+
+  if(ganged(p) && (q = c->proc) != 0 && q != p && q->pgdir == p->pgdir)
+    return rq_load(c) + 1;
+  return rq_load(c);
+}
+
+// Choose the cpu a newly runnable proc p should be queued on:
+// this cpu, unless another started cpu p may run on is less
+// loaded.  A proc that left its last cpu recently goes back
+// there to find its cache warm, unless that cpu is busier than
+// the best choice by more than one proc.
+// Caller must have interrupts disabled.
+static struct cpu*
+rq_select(struct proc *p)
+{
+  struct cpu *c, *best;
+
+  best = allowed(p, cpu) ? cpu : 0;
+  for(c = cpus; c < cpus+ncpu; c++)
+    if(c->booted && allowed(p, c) &&
+       (best == 0 || rq_cost(c, p) < rq_cost(best, p)))
+      best = c;
+  if(best == 0)
+    return cpu;
+  if((c = p->lastcpu) != 0 && c != best && allowed(p, c) &&
+     ticks - p->lastrun < AFFWINDOW &&
+     rq_cost(c, p) <= rq_cost(best, p) + 1)
+    return c;
+  return best;
+}
+
+// With gang scheduling on, return the first proc on rq, highest
+// level first, that shares its page table with a proc running
+// on another cpu at level min or above, or 0 if there is none.
+// The queues are only walked if rq->gang says a proc running
+// elsewhere may have a sibling on them.
+// Caller must hold rq->lock.
+static struct proc*
+rq_gang(struct runq *rq, int min)
+{
+  struct cpu *c;
+  struct proc *p, *q;
+  int lvl;
+
+  if(!gang || rq->ngang == 0)
+    return 0;
+  for(c = cpus; c < cpus+ncpu; c++)
+    if(c != cpu && (q = c->proc) != 0 && rq->gang[GANGHASH(q)] > 0 &&
+       rq_level(q) >= min)
+      break;
+  if(c == cpus+ncpu)
+    return 0;
+  for(lvl = NQUEUE-1; lvl >= 0; lvl--){
+    if((p = rq->queue[lvl]) == 0)
+      continue;
+    do {
+      if(p->rq_gang && gang_level(p) >= min)
+        return p;
+    } while((p = p->rq_next) != rq->queue[lvl]);
+  }
+  return 0;
+}
+
+// Return the first proc on rq, highest level first, that may
+// run on this cpu now, or 0.  Procs of a group over its quota
+// stay queued but are passed over until its next period.
+// Caller must hold rq->lock.
+static struct proc*
+rq_allowed(struct runq *rq)
+{
+  struct proc *p;
+  int lvl;
+
+  for(lvl = NQUEUE-1; lvl >= 0; lvl--){
+    if((p = rq->queue[lvl]) == 0)
+      continue;
+    do {
+      if(allowed(p, cpu) && !grp_over(p, 0))
+        return p;
+    } while((p = p->rq_next) != rq->queue[lvl]);
+  }
+  return 0;
+}
+
+// Every proc queued on this cpu's rq is of a group over its
+// quota.  Note when the first of them may run again, so idle()
+// can halt until then.  Caller must hold rq->lock.
+static void
+rq_park(struct runq *rq)
+{
+  struct proc *p;
+  uint until;
+  int lvl, found = 0;
+
+  rq->parked = rq->nrun;
+  rq->parkend = ticks + 1;
+  for(lvl = NQUEUE-1; lvl >= 0; lvl--){
+    if((p = rq->queue[lvl]) == 0)
+      continue;
+    do {
+      if(grp_over(p, &until) &&
+         (!found || (int)(until - rq->parkend) < 0)){
+        rq->parkend = until;
+        found = 1;
+      }
+    } while((p = p->rq_next) != rq->queue[lvl]);
+  }
+}
+
+// Choose the proc this cpu should run next from rq: the head of
+// the highest non-empty level, or a proc a little further down
+// that level which last ran on this cpu.  The head is only passed
+// over until it has waited AFFWAIT ticks, so affinity can delay
+// it but not starve it.  With gang scheduling on, a proc whose
+// siblings are running elsewhere goes first if one of them is
+// at the head's level or above, so a thread group shares the
+// level of its highest running member.  Procs of a group over
+// its quota are passed over (see rq_allowed()).  Returns 0 if
+// rq holds none that may run.  Caller must hold rq->lock.
+static struct proc*
+rq_pick(struct runq *rq)
+{
+  struct proc *head, *p;
+  int i;
+
+  head = schedops->pick_next(rq);
+  if(head != 0 && grp_over(head, 0) && (head = rq_allowed(rq)) == 0){
+    if(rq == &cpu->rq)
+      rq_park(rq);
+    return 0;
+  }
+  rq->parked = 0;
+  if(head != 0 && (p = rq_gang(rq, head->rq_lvl)) != 0 && !grp_over(p, 0))
+    return p;
+  if(head == 0 || head->lastcpu == cpu || head->lastcpu == 0)
+    return head;
+  if(rq->clock - head->rq_stamp >= AFFWAIT)
+    return head;
+  p = head->rq_next;
+  for(i = 1; i < AFFSCAN && p != head; i++, p = p->rq_next)
+    if(p->lastcpu == cpu && !grp_over(p, 0))
+      return p;
+  return head;
+}
+
+// Mark p RUNNABLE and queue it, behind the procs it shares its
+// turn with, on the cpu rq_select() picks, waking that cpu if it
+// is halted.
+// Caller must hold ptable.lock for a new proc, or the lock of
+// the wait queue a sleeping p has just been removed from.
+static void
+ready(struct proc *p)
+{
+  struct cpu *c = rq_select(p);
+
+  acquire(&c->rq.lock);
+  if(p->state == SLEEPING && classops(p)->wakeup)
+    classops(p)->wakeup(&c->rq, p);
+  p->chan = 0;
+  p->state = RUNNABLE;
+  classops(p)->enqueue(&c->rq, p, 0);
+  // Our own timer may be armed past the point where p
+  // should get the cpu.
+  if(c == cpu && c->tmr_far && proc && proc->state == RUNNING){
+    rq_sync(&c->rq, proc);
+    schedarm(&c->rq, proc);
+  }
+  release(&c->rq.lock);
+
+  // release() is a full barrier, so either c sees the new
+  // proc before it halts or we see c->idle (see idle()).
+  if(c != cpu && (c->idle || c->tmr_far))
+    lapicipi(c->id, T_IRQ0 + IRQ_WAKEUP);
+}
+
+// Enter p, which has just been given its pid, in the pid hash.
+// Caller must hold ptable.lock.
+static void
+pid_insert(struct proc *p)
+{
+  struct proc **chain = &ptable.pidhash[p->pid & (ptable.npidhash - 1)];
+
+  p->pid_next = *chain;
+  *chain = p;
+}
+
+// Drop p from the pid hash before its slot is freed.
+// Caller must hold ptable.lock.
+static void
+pid_remove(struct proc *p)
+{
+  struct proc **pp;
+
+  for(pp = &ptable.pidhash[p->pid & (ptable.npidhash - 1)]; *pp; pp = &(*pp)->pid_next){
+    if(*pp == p){
+      *pp = p->pid_next;
+      break;
+    }
+  }
+  p->pid_next = 0;
+}
+
+// Append the new proc p to the process table, which keeps the
+// table in pid order.  Caller must hold ptable.lock.
+static void
+tbl_append(struct proc *p)
+{
+  struct proc *head = ptable.head;
+
+  if(head == 0){
+    p->tbl_next = p;
+    p->tbl_prev = p;
+    ptable.head = p;
+  } else {
+    p->tbl_next = head;
+    p->tbl_prev = head->tbl_prev;
+    head->tbl_prev->tbl_next = p;
+    head->tbl_prev = p;
+  }
+  ptable.nproc++;
+}
+
+// Take p out of the process table and free it.
+// Caller must hold ptable.lock.
+static void
+freeproc(struct proc *p)
+{
+  pid_remove(p);
+  if(p->tbl_next == p)
+    ptable.head = 0;
+  else {
+    p->tbl_prev->tbl_next = p->tbl_next;
+    p->tbl_next->tbl_prev = p->tbl_prev;
+    if(ptable.head == p)
+      ptable.head = p->tbl_next;
+  }
+  ptable.nproc--;
+  kcachefree(&proccache, p);
+}
+
+// Return the proc with the given pid, or 0 if there is none.
+// Caller must hold ptable.lock (outside this file, between
+// ptable_lock() and ptable_unlock()), and p stays valid only
+// as long as it is held.
+struct proc*
+pidlookup(int pid)
+{
+  struct proc *p;
+
+  if(pid <= 0)
+    return 0;
+  for(p = ptable.pidhash[pid & (ptable.npidhash - 1)]; p; p = p->pid_next)
+    if(p->pid == pid)
+      return p;
+  return 0;
+}
+
+// Take and drop ptable.lock, for callers of pidlookup()
+// outside this file.
+void
+ptable_lock(void)
+{
+  acquire(&ptable.lock);
+}
+
+void
+ptable_unlock(void)
+{
+  release(&ptable.lock);
+}
+
+// Add p to the circular list *head of its parent's children or
+// threads: at the front if it is a zombie, so that the parent
+// finds it first, else at the tail.  Caller must hold ptable.lock.
+static void
+sib_add(struct proc **head, struct proc *p)
+{
+  struct proc *h = *head;
+
+  p->sib_head = head;
+  if(h == 0){
+    p->sib_next = p;
+    p->sib_prev = p;
+    *head = p;
+    return;
+  }
+  p->sib_next = h;
+  p->sib_prev = h->sib_prev;
+  h->sib_prev->sib_next = p;
+  h->sib_prev = p;
+  if(p->state == ZOMBIE)
+    *head = p;
+}
+
+// Unlink p from its parent's list and return that list.
+// Caller must hold ptable.lock.
+static struct proc**
+sib_remove(struct proc *p)
+{
+  struct proc **head = p->sib_head;
+
+  if(p->sib_next == p)
+    *head = 0;
+  else {
+    p->sib_prev->sib_next = p->sib_next;
+    p->sib_next->sib_prev = p->sib_prev;
+    if(*head == p)
+      *head = p->sib_next;
+  }
+  p->sib_next = 0;
+  p->sib_prev = 0;
+  p->sib_head = 0;
+  return head;
+}
+
+// Spin until the cpu that last ran p has switched away from it,
+// so that p's context is saved and its kernel stack and page
+// table are no longer in use.
+static void
+waitoffcpu(struct proc *p)
+{
+  while(p->oncpu)
+    ;
+  __sync_synchronize();
 }
 
-// Look in the process table for an UNUSED proc.
-// If found, change state to EMBRYO and initialize
-// state required to run in the kernel.
+// Allocate a proc and add it to the process table.
+// If the table is not full, return it in state EMBRYO
+// with the state required to run in the kernel set up.
 // Otherwise return 0.
 static struct proc*
 allocproc(void)
@@ -60,20 +594,21 @@ allocproc(void)
   char *sp;
 
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == UNUSED)
-      goto found;
-  release(&ptable.lock);
-  return 0;
-
-found:
+  if(ptable.nproc >= ptable.maxproc || (p = kcachealloc(&proccache)) == 0){
+    release(&ptable.lock);
+    return 0;
+  }
   p->state = EMBRYO;
   p->pid = nextpid++;
+  pid_insert(p);
+  tbl_append(p);
   release(&ptable.lock);
 
   // Allocate kernel stack if possible.
   if((p->kstack = kalloc()) == 0){
-    p->state = UNUSED;
+    acquire(&ptable.lock);
+    freeproc(p);
+    release(&ptable.lock);
     return 0;
   }
   sp = p->kstack + KSTACKSIZE;
@@ -92,18 +627,11 @@ found:
   memset(p->context, 0, sizeof *p->context);
   p->context->eip = (uint)forkret;
 
-  // Place p in mlfq highest level:
-  p -> level = 3;
-  for (int i=0; i<NLAYER; i++)
-  {
-    p -> ticks_curr = 0;
-    p -> wait_ticks_curr = 0;
-    p -> ticks[i] = 0;
-    p -> wait_ticks[i] = 0;
-  }
-  
-  mlfq[3][mlfq_size[3]] = p;
-  mlfq_size[3] += 1;
+  // Let the scheduling policy set p up; it is queued
+  // once its creator marks it RUNNABLE.  Its tick
+  // counters start out zeroed by kcachealloc().
+  schedops->init(p);
+  p -> affinity = (1 << ncpu) - 1;
 
   return p;
 }
@@ -134,7 +662,7 @@ userinit(void)
   safestrcpy(p->name, "initcode", sizeof(p->name));
   p->cwd = namei("/");
 
-  p->state = RUNNABLE;
+  ready(p);
   release(&ptable.lock);
 }
 
@@ -175,7 +703,9 @@ fork(void)
   if((np->pgdir = copyuvm(proc->pgdir, proc->sz)) == 0){
     kfree(np->kstack);
     np->kstack = 0;
-    np->state = UNUSED;
+    acquire(&ptable.lock);
+    freeproc(np);
+    release(&ptable.lock);
     return -1;
   }
   np->sz = proc->sz;
@@ -191,8 +721,17 @@ fork(void)
   np->cwd = idup(proc->cwd);
  
   pid = np->pid;
-  np->state = RUNNABLE;
   safestrcpy(np->name, proc->name, sizeof(proc->name));
+  acquire(&ptable.lock);
+  np->affinity = proc->affinity;
+  np->grp = proc->grp;
+  // A reservation is not inherited: it was admitted for one proc.
+  schedclass(np, proc->class == SCHED_DEADLINE ? SCHED_NORMAL : proc->class,
+             proc->rtprio);
+  np->isthread = 0;
+  sib_add(&proc->children, np);
+  ready(np);
+  release(&ptable.lock);
   return pid;
 }
 
@@ -237,73 +776,85 @@ clone(void(*fcn)(void*, void*), void *arg1, void *arg2, void *stack)
   np->cwd = idup(proc->cwd);
 
   pid = np->pid;
-  np->state = RUNNABLE;
   safestrcpy(np->name, proc->name, sizeof(proc->name));
+  acquire(&ptable.lock);
+  np->affinity = proc->affinity;
+  np->grp = proc->grp;
+  schedclass(np, proc->class == SCHED_DEADLINE ? SCHED_NORMAL : proc->class,
+             proc->rtprio);
+  np->isthread = 1;
+  sib_add(&proc->threads, np);
+  ready(np);
+  release(&ptable.lock);
   return pid;
 }
 
-// Wait for a child process to exit and return its pid.
-// Return -1 if this process has no children.
+// Wait for a child thread to exit and return its pid.
+// Return -1 if this process has no child threads.
 int
 join(void **stack)
 {
   struct proc *p;
-  int havekids, pid;
+  int pid;
 
   acquire(&ptable.lock);
   for(;;){
-    // Scan through table looking for zombie children.
-    havekids = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != proc || p->pgdir != proc->pgdir)
-        continue;
-      havekids = 1;
-      if(p->state == ZOMBIE){
-        if (p == proc) {
-          panic("proc");
-        }
-        *stack = (void *)p->ustack;
-        // Found one.
-        pid = p->pid;
-        kfree(p->kstack);
-        p->kstack = 0;
-        p->ustack = 0;
-        p->pgdir = 0;
-        p->state = UNUSED;
-        p->pid = 0;
-        p->parent = 0;
-        p->name[0] = 0;
-        p->killed = 0;
-        release(&ptable.lock);
-        return pid;
-      }
+    // Zombie threads are at the front of the list.
+    if((p = proc->threads) != 0 && p->state == ZOMBIE){
+      sib_remove(p);
+      *stack = (void *)p->ustack;
+      // Found one.
+      pid = p->pid;
+      waitoffcpu(p);
+      kfree(p->kstack);
+      freeproc(p);
+      release(&ptable.lock);
+      return pid;
     }
 
-    // No point waiting if we don't have any children.
-    if(!havekids || proc->killed){
+    // No point waiting if we don't have any threads.
+    if(p == 0 || proc->killed){
       release(&ptable.lock);
       *stack = NULL;
       return -1;
     }
 
-    // Wait for children to exit.  (See wakeup1 call in proc_exit.)
+    // Wait for children to exit.  (See wakeup call in exit.)
     sleep(proc, &ptable.lock);  //DOC: wait-sleep
   }
 }
 
 
+// Move every proc on the list *list of the current process
+// to init's children, which init reaps with wait().
+// Caller must hold ptable.lock.
+static void
+reparent(struct proc **list)
+{
+  struct proc *p;
+
+  while((p = *list) != 0){
+    sib_remove(p);
+    p->parent = initproc;
+    sib_add(&initproc->children, p);
+    if(p->state == ZOMBIE)
+      wakeup(initproc);
+  }
+}
+
 // Exit the current process.  Does not return.
 // An exited process remains in the zombie state
 // until its parent calls wait() to find out it exited.
 void
 exit(void)
 {
-  struct proc *p;
   int fd;
 
   if(proc == initproc)
     panic("init exiting");
 
+  sem_drop(proc);
+
   // Close all open files.
   for(fd = 0; fd < NOFILE; fd++){
     if(proc->ofile[fd]){
@@ -317,20 +868,24 @@ exit(void)
 
   acquire(&ptable.lock);
 
+  // Give up any deadline reservation.
+  if(proc->class == SCHED_DEADLINE)
+    dl_reserved[proc->dl_cpu - cpus] -= dl_util(proc);
+
   // Parent might be sleeping in wait().
-  wakeup1(proc->parent);
-
-  // Pass abandoned children to init.
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->parent == proc){
-      p->parent = initproc;
-      if(p->state == ZOMBIE)
-        wakeup1(initproc);
-    }
-  }
+  wakeup(proc->parent);
+
+  // Pass abandoned children and threads to init.
+  reparent(&proc->children);
+  reparent(&proc->threads);
 
   // Jump into the scheduler, never to return.
+  // The parent may see ZOMBIE as soon as ptable.lock is released;
+  // wait() spins on proc->oncpu before freeing our stack.
   proc->state = ZOMBIE;
+  sib_add(sib_remove(proc), proc);  // to the front
+  acquire(&cpu->rq.lock);
+  release(&ptable.lock);
   sched();
   panic("zombie exit");
 }
@@ -341,254 +896,514 @@ int
 wait(void)
 {
   struct proc *p;
-  int havekids, pid;
+  int pid;
 
   acquire(&ptable.lock);
   for(;;){
-    // Scan through table looking for zombie children.
-    havekids = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != proc)
-        continue;
-      havekids = 1;
-      if(p->state == ZOMBIE){
-        // Found one.
-        pid = p->pid;
-        kfree(p->kstack);
-        p->kstack = 0;
+    // Zombie children are at the front of the list.
+    if((p = proc->children) != 0 && p->state == ZOMBIE){
+      sib_remove(p);
+      // Found one.
+      pid = p->pid;
+      waitoffcpu(p);
+      kfree(p->kstack);
+      p->kstack = 0;
+      // An orphaned thread's address space belongs
+      // to the process that cloned it.
+      if(!p->isthread)
         freevm(p->pgdir);
-        p->state = UNUSED;
-        p->pid = 0;
-        p->parent = 0;
-        p->name[0] = 0;
-        p->killed = 0;
-        release(&ptable.lock);
-        return pid;
-      }
+      freeproc(p);
+      release(&ptable.lock);
+      return pid;
     }
 
     // No point waiting if we don't have any children.
-    if(!havekids || proc->killed){
+    if(p == 0 || proc->killed){
       release(&ptable.lock);
       return -1;
     }
 
-    // Wait for children to exit.  (See wakeup1 call in proc_exit.)
+    // Wait for children to exit.  (See wakeup call in exit.)
     sleep(proc, &ptable.lock);  //DOC: wait-sleep
   }
 }
 
-// Added by Roxin Liu: 
-// helper for MLFQ
-
-void
-rm_priority(int level, int index)
+// Start g's next period if its current one is over.
+// Caller must hold g->lock.
+static void
+grp_renew(struct group *g)
 {
-  //struct proc *p = mlfq[level][index];
-  if (mlfq_size[level] > 1)
+  uint late = ticks - g -> start;
+
+  if (g -> quota > 0 && late >= g -> period)
   {
-    int i;
-    for (i=index; i<mlfq_size[level]-1; i++)
-    {
-      mlfq[level][i] = mlfq[level][i+1];
-      mlfq[level][i+1] = NULL;
-    }    
+    g -> start += late / g -> period * g -> period;
+    g -> used = 0;
   }
-  else
-    mlfq[level][index] = NULL;
-  
-  mlfq_size[level] -= 1;
-  return;
 }
 
-// Edited by Roxin Liu: 
-
-// Per-CPU process scheduler.
-// Each CPU calls scheduler() after setting itself up.
-// Scheduler never returns.  It loops, doing:
-//  - choose a process to run
-//  - swtch to start running that process
-//  - eventually that process transfers control
-//      via swtch back to the scheduler.
-// MLFQ scheduler:
-void
-scheduler(void)
+// Has p's group used up its quota for this period?  If so, and
+// until is not 0, set *until to ticks when the next one starts.
+static int
+grp_over(struct proc *p, uint *until)
 {
-  struct proc *p;
-
-  for(;;){
-    // Enable interrupts on this processor.
-    sti();
-
-    // Loop over process table looking for process to run.
-    // Lock ptable:
-    acquire(&ptable.lock);
+  struct group *g = &groups[p -> grp];
+  int over;
 
-    int lvl;
-    for (lvl = NLAYER-1; lvl >= 0; lvl--)
-    {
-      int i; 
-      for (i = 0; i < mlfq_size[lvl]; i++)
-      {
-        // Check each proc in priority queue:
-        // If not runnable, continue to next iteration;
-        // If there is no runnable proc in this level, 
-        // move to next level when the for loop exits.
-        p = mlfq[lvl][i];
-        if (p -> state != RUNNABLE)
-          continue;
-          
-        // Runnable process found:
-        proc = p;
-     
-        // Incrementing wait_ticks on each proc's own level:
-        struct proc *p_wait;
-        for(p_wait = ptable.proc; p_wait < &ptable.proc[NPROC]; p_wait++) {
-          if (p_wait -> state == RUNNABLE && p_wait->pid > 0) {
-            p_wait -> wait_ticks[p_wait->level] += 1;
-            p_wait -> wait_ticks_curr += 1;
-          }
-        }
-
-        // Run p:
-        switchuvm(p); 
-        p -> state = RUNNING;
-        p -> ticks_curr += 1;
-        p -> wait_ticks_curr = 0;
-        p -> ticks[lvl] += 1;
-        //p -> wait_ticks[lvl] = 0;
-        swtch(&cpu->scheduler, proc->context); // context switch and run
-        switchkvm();
-        proc = 0;
-        
-        // Downgrading:
-        if (lvl > 0 && p -> ticks_curr >= limit_total[lvl])
-        { 
-          // Remove p from current level: 
-          rm_priority(lvl, i);
-
-          // Add p to new level:
-          mlfq[lvl-1][mlfq_size[lvl-1]] = p;
-          mlfq_size[lvl-1] += 1;
-
-          // Set p's struct members:
-          p -> ticks_curr = 0;
-          p -> wait_ticks_curr = 0;
-          p -> wait_ticks[lvl] = 0; // Bad idea
-          //p -> wait_ticks[lvl] = 0;
-          p -> level = lvl - 1;
-        }
-        
-        // Round robin:
-        else if ((p->ticks_curr % limit_rr[lvl]) == 0)
-        {
-          //cprintf("RR: level %d index %d\n", lvl, i);
-          
-          // Remove p from current level: 
-          rm_priority(lvl, i);
-          
-          // Add p to the end of the queue:
-          mlfq[lvl][mlfq_size[lvl]] = p;
-          mlfq_size[lvl] += 1;
-        }
-        
-        
-        // Promotion:
-        struct proc *p_starve;
-        for (lvl = NLAYER-1; lvl >= 0; lvl--)
-        {
-          int i; 
-          for (i = 0; i < mlfq_size[lvl]; i++)
-          {
-            p_starve = mlfq[lvl][i];
-            
-            // Check if p_starve has waited 10 times the time slice in its current level:
-            if (p_starve -> wait_ticks_curr >= 10 * limit_total[p_starve->level])
-            {
-              rm_priority(lvl, i);
-              mlfq[lvl+1][mlfq_size[lvl+1]] = p_starve;
-              mlfq_size[lvl+1] += 1;
-              p_starve -> ticks_curr = 0;
-              p_starve -> wait_ticks_curr = 0;
-              p_starve -> wait_ticks[lvl] = 0; // Bad idea
-              p_starve -> level += 1;
-            }
-          }
-        }
-
-        i = -1; 
-          // Reset to run from beginning of the queue if a proc has been run
-      }
-    }
+  if (g -> quota == 0)
+    return 0;
+  acquire(&g -> lock);
+  grp_renew(g);
+  if ((over = g -> quota > 0 && g -> used >= g -> quota) && until)
+    *until = g -> start + g -> period;
+  release(&g -> lock);
+  return over;
+}
 
-    /* 
-     * ROUND-ROBIN DEFAULT SCHEDULER:
-     *
-    
-    // Loop over process table looking for process to run.
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->state != RUNNABLE)
-        continue;
+// Ticks p's group may still run this period, or 0 for no limit.
+static uint
+grp_left(struct proc *p)
+{
+  struct group *g = &groups[p -> grp];
+  int left;
 
-      // Switch to chosen process.  It is the process's job
-      // to release ptable.lock and then reacquire it
-      // before jumping back to us.
-      proc = p;
-      switchuvm(p); 
-      	// switch to user virtual memory, 
-	    // which assigns PTBR the address of user mode page table.
-	    // PTBR stands for page table base register 
-      p->state = RUNNING;
-
-      //cprintf("Running process PID %d and name %s\n", p->pid, p->name);
-      //cprintf("time before switch = %LF\n", (long double)ticks);
-
-      // Jumps or switches the execution from here 
-      // to whatever is in proc->context:
-      swtch(&cpu->scheduler, proc->context); // src: kernel/swtch.S
-	
-      //cprintf("time after switch = %LF\n", ticks); 	
-      
-      switchkvm(); // switch to kernel virtual memory, setting PTBR.
+  if (g -> quota == 0)
+    return 0;
+  acquire(&g -> lock);
+  grp_renew(g);
+  left = g -> quota - g -> used;
+  release(&g -> lock);
+  return left > 0 ? left : 0;
+}
 
-      // Process is done running for now.
-      // It should have changed its p->state before coming back.
-      proc = 0;
-    }
-    */
-    release(&ptable.lock);
+// Charge proc p's group for n ticks p starts or runs on.
+static void
+grp_charge(struct proc *p, uint n)
+{
+  struct group *g = &groups[p -> grp];
 
+  acquire(&g -> lock);
+  g -> usage += n;
+  if (g -> quota > 0)
+  {
+    grp_renew(g);
+    if (g -> used < g -> quota && g -> used + n >= g -> quota)
+      g -> throttled++;
+    g -> used += n;
   }
+  release(&g -> lock);
 }
 
-// Enter scheduler.  Must hold only ptable.lock
-// and have changed proc->state.
-void
-sched(void)
+// Charge proc p for n ticks it starts or runs on, and the
+// scheduling policy and p's group with it.  Caller must hold
+// rq->lock.
+static void
+account(struct proc *p, uint n)
 {
-  int intena;
+  p -> ticks_curr += n;
+  p -> ticks[p -> level] += n;
+  if (classops(p)->charge)
+    classops(p)->charge(p, n);
+  grp_charge(p, n);
+}
 
-  if(!holding(&ptable.lock))
-    panic("sched ptable.lock");
-  if(cpu->ncli != 1)
-    panic("sched locks");
-  if(proc->state == RUNNING)
-    panic("sched running");
-  if(readeflags()&FL_IF)
-    panic("sched interruptible");
-  intena = cpu->intena;
-  swtch(&proc->context, cpu->scheduler);
-  cpu->intena = intena;
+// Charge the running proc p for n ticks it kept the cpu across,
+// as if it had been dispatched again at each of them.
+// Caller must hold rq->lock.
+static void
+rq_run(struct runq *rq, struct proc *p, uint n)
+{
+  rq->clock += n;
+  account(p, n);
 }
 
-// Give up the CPU for one scheduling round.
+// Charge the running proc for the ticks it has run through
+// since the timer last reported them.  Caller must hold rq->lock.
+static void
+rq_sync(struct runq *rq, struct proc *p)
+{
+  uint n;
+
+  if((n = lapicticks()) != 0)
+    rq_run(rq, p, n);
+}
+
+// Is a level above the one p runs at non-empty, so that p should
+// give way whatever its class?  Caller must hold rq->lock.
+static int
+rq_above(struct runq *rq, struct proc *p)
+{
+  return (rq->mask >> (rq_level(p) + 1)) != 0;
+}
+
+// Arm this cpu's timer for the next tick the class of p needs
+// while p runs.  The boot cpu also wakes for the earliest
+// sleep() deadline.  Caller must hold rq->lock.
+static void
+schedarm(struct runq *rq, struct proc *p)
+{
+  uint n, m;
+
+  if(!dyntick)
+    return;
+  n = rq_above(rq, p) ? 1 : classops(p)->nexttick(rq, p);
+  // The tick at which p's group will have used its quota,
+  // if every cpu is running one of it.
+  if(groups[p->grp].quota > 0){
+    m = grp_left(p) / ncpu + 1;
+    if(n == 0 || m < n)
+      n = m;
+  }
+  if(cpu == &cpus[mpbcpu()] && (m = tickalarmin()) != 0)
+    if(n == 0 || m < n)
+      n = m;
+  if(n == 0)
+    n = ~0;
+  cpu->tmr_far = n > 1;
+  lapicarm(n);
+}
+
+// Move one proc from the busiest other cpu onto this cpu's queues.
+// Steals the proc the victim would run next, so the highest
+// levels drain first across cpus, unless it may not run here.
+// Must not hold any run queue lock.
+// Returns 1 if a proc was moved.
+static int
+steal(void)
+{
+  struct cpu *c, *victim;
+  struct proc *p;
+
+  victim = 0;
+  for(c = cpus; c < cpus+ncpu; c++)
+    if(c != cpu && c->rq.nrun > 0 && (victim == 0 || c->rq.nrun > victim->rq.nrun))
+      victim = c;
+  if(victim == 0)
+    return 0;
+
+  acquire(&victim->rq.lock);
+  if((p = rq_pick(&victim->rq)) != 0 && !allowed(p, cpu))
+    p = rq_allowed(&victim->rq);
+  if(p != 0)
+    classops(p)->dequeue(&victim->rq, p);
+  release(&victim->rq.lock);
+  if(p == 0)
+    return 0;
+
+  // p stays RUNNABLE while it is on no queue; nothing else
+  // changes the state of a RUNNABLE proc.
+  acquire(&cpu->rq.lock);
+  classops(p)->enqueue(&cpu->rq, p, 0);
+  release(&cpu->rq.lock);
+  return 1;
+}
+
+// p, which shares its page table, has just been dispatched on
+// this cpu.  Under dynamic ticks, make every other cpu that is
+// running something else with a sibling of p queued look for it
+// now (see gang_preempt()) rather than at its next tick.  Reads
+// the other queues' counts without their locks, so a sibling
+// queued just now may wait for the tick.
+static void
+gang_kick(struct proc *p)
+{
+  struct cpu *c;
+  struct proc *q;
+  int h;
+
+  if(!dyntick)
+    return;
+  h = GANGHASH(p);
+  for(c = cpus; c < cpus+ncpu; c++)
+    if(c != cpu && c->booted && c->rq.gang[h] > 0 &&
+       (q = c->proc) != 0 && q->pgdir != p->pgdir)
+      lapicipi(c->id, T_IRQ0 + IRQ_WAKEUP);
+}
+
+// Should the running proc p make way for a gang on rq?  Only if
+// p is not itself running alongside its own siblings, so two
+// gangs do not keep taking cpus from each other.
+// Caller must hold rq->lock.
+static int
+gang_preempt(struct runq *rq, struct proc *p)
+{
+  if(!gang || (ganged(p) && gang_level(p) >= 0))
+    return 0;
+  return rq_gang(rq, rq_level(p)) != 0;
+}
+
+// Take p, chosen by rq_pick(), off the queues to run it on
+// this cpu, and charge it for the tick it starts.
+// Caller must hold rq->lock.
+static void
+dispatch(struct runq *rq, struct proc *p)
+{
+  // Every proc queued here, p included, waits one more tick
+  // (charged lazily by rq_remove()).
+  rq->clock++;
+
+  // Runnable process found; it is off the queues while it runs.
+  classops(p)->dequeue(rq, p);
+
+  // A proc woken onto this cpu may still be switching
+  // out on the cpu it slept on.
+  if (p != proc)
+    waitoffcpu(p);
+
+  if (p -> lastcpu != 0 && p -> lastcpu != cpu)
+  {
+    cpu -> migrations++;
+    p -> migrations++;
+  }
+  p -> lastcpu = cpu;
+
+  p -> state = RUNNING;
+  p -> wait_ticks_curr = 0;
+  account(p, 1);
+  schedarm(rq, p);
+  if (ganged(p))
+    gang_kick(p);
+}
+
+// Finish a switch away from cpu->prev: its context is saved and
+// its stack and page table are no longer in use, so another cpu
+// may now run or free it.  Called first thing by whatever
+// context sched() switched to.
+static void
+finishswitch(void)
+{
+  struct proc *p;
+
+  if((p = cpu->prev) == 0)
+    return;
+  cpu->prev = 0;
+  __sync_synchronize();
+  p -> oncpu = 0;
+}
+
+// Halt this cpu until an interrupt arrives: a timer tick, a
+// device, or the IPI ready() sends when it queues work here.
+static void
+idle(void)
+{
+  uint n, m;
+
+  // Wake any sleep() callers that are due before deciding
+  // there is nothing to do.
+  tickupdate();
+
+  cli();
+  cpu->idle = 1;
+
+  // Publish idle before looking at the queue one last time,
+  // pairing with the barrier in ready().  Procs of throttled
+  // groups (see rq_park()) do not keep the cpu awake.
+  __sync_synchronize();
+  if(cpu->rq.nrun == 0 || cpu->rq.nrun == cpu->rq.parked){
+    // Take no timer interrupts while halted, except on the
+    // cpu that wakes sleep() callers, and when the first
+    // throttled group here may run again.
+    cpu->tmr_far = 0;
+    n = cpu == &cpus[mpbcpu()] ? tickalarmin() : 0;
+    if(cpu->rq.nrun > 0){
+      m = (int)(cpu->rq.parkend - ticks) > 0 ? cpu->rq.parkend - ticks : 1;
+      if(n == 0 || m < n)
+        n = m;
+    }
+    lapicarm(n);
+    cpu->idle_start = ticks;
+    stihlt();
+    cli();
+    tickupdate();
+    cpu->idle_ticks += ticks - cpu->idle_start;
+  }
+  cpu->idle = 0;
+}
+
+// Edited by Roxin Liu: 
+
+// Per-CPU process scheduler.
+// Each CPU calls scheduler() after setting itself up.
+// Scheduler never returns.  It loops, doing:
+//  - choose a process to run
+//  - swtch to start running that process
+//  - eventually that process transfers control
+//      via swtch back to the scheduler.
+// Each cpu runs the proc the scheduling policy picks from its
+// own run queues (see rq_pick()), and steals from the busiest
+// cpu when its own queues are empty.
+// sched() switches from proc to proc directly, so a cpu
+// only comes back here when it runs out of procs.
+void
+scheduler(void)
+{
+  struct proc *p;
+  struct runq *rq;
+
+  for(;;){
+    // Enable interrupts on this processor.
+    sti();
+
+    // Lock this cpu's run queues:
+    rq = &cpu->rq;
+    acquire(&rq->lock);
+
+    if ((p = rq_pick(rq)) != 0)
+    {
+      dispatch(rq, p);
+
+      // Run p:
+      proc = p;
+      p -> oncpu = 1;
+      switchuvm(p); 
+      swtch(&cpu->scheduler, proc->context); // context switch and run
+
+      // Some proc, not necessarily p, had nothing to
+      // switch to (see sched()).
+      switchkvm();
+      proc = 0;
+      finishswitch();
+      release(&rq->lock);
+      continue;
+    }
+    release(&rq->lock);
+
+    // Nothing runnable here: take work from a busier cpu, zero
+    // a page for kalloc_zeroed() and look again, or halt until
+    // there is something to do.
+    if(!steal() && !kzero())
+      idle();
+  }
+}
+
+// Called on every timer interrupt, on every cpu.
+// Lets the scheduling policy work on this cpu's run queues,
+// such as promoting starving procs under the MLFQ, and renews
+// the periods of queued deadline procs (see dl_tick()).
+// Returns 1 if the running proc should yield().
+//
+// With dynamic ticks the timer only fires at the next tick the
+// policy has a use for (see schedarm()), or ready() sends an
+// IPI when the queues change under a far-off deadline.  The
+// running proc is charged for the ticks it ran through as if it
+// had been dispatched at each, and keeps the cpu unless the
+// policy would switch it out at this one.
+int
+schedtick(void)
+{
+  struct runq *rq = &cpu->rq;
+  struct proc *p = proc;
+  int preempt;
+  uint n;
+
+  acquire(&rq->lock);
+  if(!dyntick || p == 0 || p->state != RUNNING){
+    if(schedops->tick)
+      schedops->tick(rq);
+    dl_tick(rq);
+    release(&rq->lock);
+    return 1;
+  }
+  n = lapicticks();
+  if(n > 1)
+    rq_run(rq, p, n - 1);
+  if(schedops->tick)
+    schedops->tick(rq);
+  dl_tick(rq);
+  // A higher class or level gets the cpu at once: ready()
+  // sends an IPI when it queues a proc above a running one.
+  // setaffinity() and gang_kick() send IPIs to move p off
+  // this cpu, or to make way for a thread group.
+  preempt = rq_above(rq, p) || (n > 0 && classops(p)->preempt(rq, p)) ||
+            !allowed(p, cpu) || gang_preempt(rq, p) || grp_over(p, 0);
+  if(!preempt){
+    if(n > 0)
+      rq_run(rq, p, 1);
+    schedarm(rq, p);
+  }
+  release(&rq->lock);
+  return preempt;
+}
+
+// Switch to the next proc, or enter scheduler.  Must hold
+// only this cpu's run queue lock and have changed proc->state.
+void
+sched(void)
+{
+  struct proc *prev, *next;
+  int intena;
+
+  if(!holding(&cpu->rq.lock))
+    panic("sched rq.lock");
+  if(cpu->ncli != 1)
+    panic("sched locks");
+  if(proc->state == RUNNING)
+    panic("sched running");
+  if(readeflags()&FL_IF)
+    panic("sched interruptible");
+  intena = cpu->intena;
+
+  // Switch straight to the next proc on this cpu's queues
+  // (which may be proc itself, after yield()).  Go through
+  // the scheduler when there is none, and when the next one
+  // is still switching out on another cpu: waiting for it
+  // here could deadlock with that cpu waiting for us.
+  prev = proc;
+  prev->lastrun = ticks;
+  next = rq_pick(&cpu->rq);
+  if(next != 0 && next != prev && next->oncpu)
+    next = 0;
+  if(next != 0)
+    dispatch(&cpu->rq, next);
+  if(next != prev){
+    cpu->prev = prev;
+    if(next == 0)
+      swtch(&prev->context, cpu->scheduler);
+    else {
+      proc = next;
+      next->oncpu = 1;
+      // Threads of one process share their page table.
+      if(next->pgdir == prev->pgdir)
+        switchkstack(next);
+      else
+        switchuvm(next);
+      swtch(&prev->context, next->context);
+    }
+    finishswitch();
+  }
+  cpu->intena = intena;
+}
+
+// Give up the CPU for one scheduling round.
+// proc goes back on this cpu's queues before it switches out;
+// nobody else can take it until the scheduler drops rq.lock.
+// A proc setaffinity() has moved off this cpu is queued on
+// one it may use instead, whose dispatch() then waits for us
+// to finish switching out.
 void
 yield(void)
 {
-  acquire(&ptable.lock);  //DOC: yieldlock
-  proc->state = RUNNABLE;
+  struct runq *rq;
+  int tail;
+
+  acquire(&cpu->rq.lock);  //DOC: yieldlock
+  rq = &cpu->rq;
+  rq_sync(rq, proc);
+  tail = classops(proc)->stop(proc);
+  if(!allowed(proc, cpu)){
+    // ready() takes the other cpu's rq.lock, which must
+    // not nest inside ours; stay uninterruptible between.
+    pushcli();
+    release(&cpu->rq.lock);
+    ready(proc);
+    acquire(&cpu->rq.lock);
+    popcli();
+  } else {
+    proc->state = RUNNABLE;
+    classops(proc)->enqueue(rq, proc, !tail);
+  }
   sched();
-  release(&ptable.lock);
+  release(&cpu->rq.lock);
 }
 
 // A fork child's very first scheduling by scheduler()
@@ -596,8 +1411,10 @@ yield(void)
 void
 forkret(void)
 {
-  // Still holding ptable.lock from scheduler.
-  release(&ptable.lock);
+  // Still holding this cpu's rq.lock from scheduler()
+  // or sched().
+  finishswitch();
+  release(&cpu->rq.lock);
   
   // Return to "caller", actually trapret (see allocproc).
 }
@@ -607,62 +1424,97 @@ forkret(void)
 void
 sleep(void *chan, struct spinlock *lk)
 {
+  struct waitq *wq;
+
   if(proc == 0)
     panic("sleep");
 
   if(lk == 0)
     panic("sleep without lk");
 
-  // Must acquire ptable.lock in order to
-  // change p->state and then call sched.
-  // Once we hold ptable.lock, we can be
-  // guaranteed that we won't miss any wakeup
-  // (wakeup runs with ptable.lock locked),
-  // so it's okay to release lk.
-  if(lk != &ptable.lock){  //DOC: sleeplock0
-    acquire(&ptable.lock);  //DOC: sleeplock1
-    // If wake up happens after this line, 
-    // then we will not be interrupted
-    release(lk);
-    // we can now safely release the lock having ptable lock grabbed
-  }
-
-  // Go to sleep.
+  // Must acquire the wait queue lock for chan in
+  // order to change p->state and then call sched.
+  // Once we hold it, we can be guaranteed that we
+  // won't miss any wakeup (wakeup runs with the
+  // wait queue lock locked), so it's okay to release lk.
+  wq = wq_hash(chan);
+  acquire(&wq->lock);  //DOC: sleeplock1
+  // If wake up happens after this line, 
+  // then we will not be interrupted
+  release(lk);
+  // we can now safely release the lock having the wait queue lock grabbed
+
+  // Go to sleep.  Settle the policy's state first: a waker may
+  // queue us on another cpu as soon as wq->lock is released.
+  acquire(&cpu->rq.lock);
+  rq_sync(&cpu->rq, proc);
+  classops(proc)->stop(proc);
   proc->chan = chan; // Remember the channel passed to it
   proc->state = SLEEPING;
+  wq_append(wq, proc);
+  release(&wq->lock);
   sched();  // switch to scheduler context 
             // to pick some other thread to run
   // the next line here will be executed only when this thread is waken up 
-
-  // Tidy up.
-  proc->chan = 0;
+  // (wakeup() has already cleared proc->chan).
+  release(&cpu->rq.lock);
 
   // Reacquire original lock.
-  if(lk != &ptable.lock){  //DOC: sleeplock2
-    release(&ptable.lock);
-    acquire(lk);
-  }
+  acquire(lk);  //DOC: sleeplock2
 }
 
-// Wake up all processes sleeping on chan.
-// The ptable lock must be held.
-static void
-wakeup1(void *chan)
+// sleep() waiting for I/O: a device, the console or a pipe.  The
+// scheduling policy may credit a proc woken from it as interactive
+// (see mlfq_wakeup()).
+void
+sleepio(void *chan, struct spinlock *lk)
 {
-  struct proc *p;
+  proc->iowait = 1;
+  sleep(chan, lk);
+  proc->iowait = 0;
+}
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == SLEEPING && p->chan == chan)
-      p->state = RUNNABLE;
+// Wake up the processes sleeping on chan, oldest first:
+// all of them, or only the first if all is 0.
+static void
+wakeup1(void *chan, int all)
+{
+  struct waitq *wq = wq_hash(chan);
+  struct proc *p, *next, *tail;
+
+  acquire(&wq->lock);
+  if((p = wq->head) != 0){
+    tail = p->wq_prev;
+    for(;;){
+      next = p->wq_next;
+      if(p->chan == chan){
+        wq_remove(wq, p);
+        ready(p);
+        if(!all || p == tail)
+          break;
+      } else if(p == tail)
+        break;
+      p = next;
+    }
+  }
+  release(&wq->lock);
 }
 
 // Wake up all processes sleeping on chan.
 void
 wakeup(void *chan)
 {
-  acquire(&ptable.lock);
-  wakeup1(chan);
-  release(&ptable.lock);
+  wakeup1(chan, 1);
+}
+
+// Wake up the process that has slept longest on chan.
+// Enough for a lock handed from one holder to the next,
+// where a woken sleeper that finds the lock taken goes
+// back to sleep until its new holder releases it.
+void
+wakeone(void *chan)
+{
+  wakeup1(chan, 0);
 }
 
 // Kill the process with the given pid.
@@ -672,17 +1524,29 @@ int
 kill(int pid)
 {
   struct proc *p;
+  struct waitq *wq;
+  void *chan;
 
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      p->killed = 1;
-      // Wake process from sleep if necessary.
-      if(p->state == SLEEPING)
-        p->state = RUNNABLE;
-      release(&ptable.lock);
-      return 0;
+  if((p = pidlookup(pid)) != 0){
+    p->killed = 1;
+    // Wake process from sleep if necessary.  p->chan is
+    // only stable under its wait queue's lock, so look
+    // again once we hold it.
+    while(p->state == SLEEPING && (chan = p->chan) != 0){
+      wq = wq_hash(chan);
+      acquire(&wq->lock);
+      if(p->state == SLEEPING && p->chan == chan){
+        wq_remove(wq, p);
+        // Being killed is no I/O completion: no boost for it
+        // (see mlfq_wakeup()).
+        p->iowait = 0;
+        ready(p);
+      }
+      release(&wq->lock);
     }
+    release(&ptable.lock);
+    return 0;
   }
   release(&ptable.lock);
   return -1;
@@ -707,9 +1571,9 @@ procdump(void)
   char *state;
   uint pc[10];
   
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->state == UNUSED)
-      continue;
+  if((p = ptable.head) == 0)
+    return;
+  do {
     if(p->state >= 0 && p->state < NELEM(states) && states[p->state])
       state = states[p->state];
     else
@@ -721,13 +1585,36 @@ procdump(void)
         cprintf(" %p", pc[i]);
     }
     cprintf("\n");
-  }
+  } while((p = p->tbl_next) != ptable.head);
 }
 
 /* Added by Roxin Liu: */
 
 
-// This system call stores info of all proc in mlfq to pstat:
+// Charge a queued proc for the wait rq_remove() has not
+// yet added to its wait_ticks.  Caller must hold ptable.lock.
+static int
+wait_pending(struct proc *p)
+{
+  struct runq *rq;
+
+  if ((rq = p -> rq) == 0)
+    return 0;
+  return rq -> clock - p -> rq_stamp;
+}
+
+// Index of the cpu p is running on, or -1.
+static int
+proc_cpu(struct proc *p)
+{
+  if (p -> state != RUNNING || p -> lastcpu == 0)
+    return -1;
+  return p -> lastcpu - cpus;
+}
+
+// This system call stores info of the first NPROC procs
+// in the process table to pstat.  See getprocs() for
+// walking a table larger than that.
 int 
 getprocinfo(struct pstat *allstat)
 {
@@ -735,72 +1622,589 @@ getprocinfo(struct pstat *allstat)
     return -1; // failure
 
   struct proc *p;
+  struct group *g;
   int i, j;
   
   acquire(&ptable.lock);
 
-  // Iterate through all procs in mlfq:
-
-  //for(i=0; i<NPROC; i++){
-    //p = &ptable.proc[i]; 
-  for (int lvl = NLAYER-1; lvl >= 0; lvl--)
-  {
-    //cprintf("lvl = %d\n", lvl);
-    for (i = 0; i < mlfq_size[lvl]; i++)
+  // Iterate through the process table; sleeping procs are
+  // not on the run queues but are still reported.
+  p = ptable.head;
+  for(i=0; i<NPROC; i++){
+    if (p == 0)
     {
-      p = mlfq[lvl][i]; 
+      allstat -> inuse[i] = 0;
+      allstat -> pid[i] = 0;
+      allstat -> cpu[i] = -1;
+      allstat -> group[i] = 0;
+      allstat -> ioboosts[i] = 0;
+      continue;
+    }
       
-      // Collect info:
-      allstat -> inuse[i] = 1;
-      allstat -> pid[i] = p -> pid;
-      allstat -> priority[i] = p -> level;
-      allstat -> state[i] = p -> state;
+    // Collect info:
+    allstat -> inuse[i] = 1;
+    allstat -> pid[i] = p -> pid;
+    allstat -> priority[i] = p -> level;
+    allstat -> state[i] = p -> state;
+
+    for (j=0; j<NLAYER; j++)
+    {
+      allstat -> ticks[i][j] = p -> ticks[j];
+      allstat -> wait_ticks[i][j] = p -> wait_ticks[j];
+    }
+    allstat -> wait_ticks[i][p -> level] += wait_pending(p);
+    allstat -> cpu[i] = proc_cpu(p);
+    allstat -> group[i] = p -> grp;
+    allstat -> ioboosts[i] = p -> ioboosts;
+
+    if ((p = p -> tbl_next) == ptable.head)
+      p = 0;
+  }
+  release(&ptable.lock);
+
+  for (i = 0; i < NGROUP; i++)
+  {
+    g = &groups[i];
+    acquire(&g -> lock);
+    grp_renew(g);
+    allstat -> grp_quota[i] = g -> quota;
+    allstat -> grp_period[i] = g -> period;
+    allstat -> grp_used[i] = g -> used;
+    allstat -> grp_usage[i] = g -> usage;
+    allstat -> grp_throttled[i] = g -> throttled;
+    release(&g -> lock);
+  }
+  return 0;	
+}
 
+// Store info of up to n procs whose pid is at least pid in
+// info, in pid order.  Returns the number stored; a caller
+// walks the whole table by passing one more than the last
+// pid it got back until 0 is returned.
+int
+getprocs(int pid, struct procinfo *info, int n)
+{
+  struct proc *p;
+  int i, j;
+
+  if (info == NULL || n < 0)
+    return -1;
+
+  acquire(&ptable.lock);
+  i = 0;
+  if ((p = ptable.head) != 0)
+  {
+    do {
+      if (p -> pid < pid)
+        continue;
+      if (i == n)
+        break;
+      info[i].pid = p -> pid;
+      info[i].priority = p -> level;
+      info[i].state = p -> state;
       for (j=0; j<NLAYER; j++)
       {
-        allstat -> ticks[i][j] = p -> ticks[j];
-        allstat -> wait_ticks[i][j] = p -> wait_ticks[j];
+        info[i].ticks[j] = p -> ticks[j];
+        info[i].wait_ticks[j] = p -> wait_ticks[j];
       }
-    
+      info[i].wait_ticks[p -> level] += wait_pending(p);
+      info[i].migrations = p -> migrations;
+      info[i].cpu = proc_cpu(p);
+      info[i].class = p -> class;
+      info[i].missed = p -> dl_missed;
+      info[i].ioboosts = p -> ioboosts;
+      i++;
+    } while ((p = p -> tbl_next) != ptable.head);
+  }
+  release(&ptable.lock);
+  return i;
+}
+
+// Store the idle time of every started cpu in cs.
+int
+getcpuinfo(struct cpustat *cs)
+{
+  struct cpu *c;
+  int i;
+
+  if (cs == NULL)
+    return -1;
+
+  tickupdate();
+  safestrcpy(cs -> policy, schedops->name, sizeof(cs -> policy));
+  cs -> ncpu = ncpu;
+  for (i = 0; i < ncpu; i++)
+  {
+    c = &cpus[i];
+    cs -> idle_ticks[i] = c -> idle_ticks;
+    cs -> migrations[i] = c -> migrations;
+    if (c -> idle)
+      cs -> idle_ticks[i] += ticks - c -> idle_start;
+  }
+  return 0;
+}
+
+// The cpu whose run queue rq is.
+static struct cpu*
+rq_cpu(struct runq *rq)
+{
+  struct cpu *c;
+
+  for (c = cpus; &c -> rq != rq; c++)
+    ;
+  return c;
+}
+
+// Restrict the proc with the given pid to the cpus in mask
+// (bit i for cpu i).  The mask is inherited by fork() and
+// clone().  A queued proc on a cpu it may no longer use is
+// moved at once; a running one is sent an IPI and moves when
+// it next yields.  Returns -1 if there is no such proc, mask
+// holds no started cpu, or p has a deadline reservation that no
+// cpu in mask has room for.
+int
+setaffinity(int pid, int mask)
+{
+  struct proc *p;
+  struct runq *rq;
+  struct cpu *c;
+  int requeue, share;
+
+  mask &= (1 << ncpu) - 1;
+  if (mask == 0)
+    return -1;
+
+  acquire(&ptable.lock);
+  if ((p = pidlookup(pid)) == 0 || p -> state == ZOMBIE)
+  {
+    release(&ptable.lock);
+    return -1;
+  }
+  // A deadline reservation moves to a cpu in mask with room, if
+  // its own is not in it.
+  if (p -> class == SCHED_DEADLINE && !((mask >> (p -> dl_cpu - cpus)) & 1))
+  {
+    share = dl_util(p);
+    if ((c = dl_place(share, mask)) == 0)
+    {
+      release(&ptable.lock);
+      return -1;
+    }
+    dl_reserved[p -> dl_cpu - cpus] -= share;
+    dl_reserved[c - cpus] += share;
+    p -> dl_cpu = c;
+  }
+  p -> affinity = mask;
+
+  // p -> rq only changes under the lock of the queue p is on;
+  // rq_lockproc() looks again if steal() moves p meanwhile.
+  requeue = 0;
+  if ((rq = rq_lockproc(p)) != 0)
+  {
+    c = rq_cpu(rq);
+    if (!allowed(p, c) && p -> rq == rq)
+    {
+      classops(p)->dequeue(rq, p);
+      requeue = 1;
     }
+    else if (!allowed(p, c) && p != proc)
+      lapicipi(c -> id, T_IRQ0 + IRQ_WAKEUP);
+    release(&rq -> lock);
+    // p stays RUNNABLE while it is on no queue (see steal()).
+    if (requeue)
+      ready(p);
   }
   release(&ptable.lock);
-  return 0;	
+
+  if (p == proc && !allowed(p, cpu))
+    yield();
+  return 0;
 }
 
-// This system call boost the current process to one higher priority level.
-int 
-boostproc(void)
+// Return the mask of cpus the proc with the given pid may
+// run on, or -1 if there is no such proc.
+int
+getaffinity(int pid)
 {
-  struct proc *p = proc; // p points to current process
-  int level = p -> level; // proc's current level
-  if (level == 3) 
-    return 0; // Do not boost at highest level
+  struct proc *p;
+  int mask;
+
+  acquire(&ptable.lock);
+  if ((p = pidlookup(pid)) == 0)
+    mask = -1;
+  else
+    mask = p -> affinity;
+  release(&ptable.lock);
+  return mask;
+}
+
+// Turn gang scheduling of procs that share a page table on
+// (on != 0) or off.  While it is on, the siblings of a thread
+// that is running are queued away from the cpus it and its
+// other siblings run on, and dispatched ahead of other procs
+// at their level (see rq_pick()).  Returns the previous setting.
+int
+setgang(int on)
+{
+  int old = gang;
+
+  gang = (on != 0);
+  return old;
+}
+
+// Lock the run queue p is on, or that of the cpu p runs on, and
+// return it; or return 0 if p is neither queued nor running.
+// Nobody else looks at the class or level of such a proc until
+// it is queued, and rq_remove() goes by p -> rq_lvl, so a proc
+// woken just as they change stays where it was queued.
+static struct runq*
+rq_lockproc(struct proc *p)
+{
+  struct runq *rq;
+
+  for (;;)
+  {
+    rq = p -> rq;
+    if (rq == 0 && p -> state == RUNNING && p -> lastcpu != 0)
+      rq = &p -> lastcpu -> rq;
+    if (rq == 0)
+      return 0;
+    acquire(&rq -> lock);
+    if (p -> rq == rq)
+      return rq;
+    if (p -> rq == 0 && p -> state == RUNNING && &p -> lastcpu -> rq == rq)
+      return rq;
+    release(&rq -> lock);
+  }
+}
+
+// Move p to scheduling class cls at real-time priority prio.  A
+// queued proc is requeued in its new class at once, and the cpu
+// a running proc is on is sent an IPI to look at it again.
+// Caller must hold ptable.lock.
+static void
+chclass(struct proc *p, int cls, int prio)
+{
+  struct runq *rq;
+  struct cpu *c;
+  int requeue = 0;
+
+  if ((rq = rq_lockproc(p)) == 0)
+  {
+    schedclass(p, cls, prio);
+    return;
+  }
+  c = rq_cpu(rq);
+  if (p -> rq == rq)
+  {
+    classops(p) -> dequeue(rq, p);
+    schedclass(p, cls, prio);
+    // A deadline proc may only run on the cpu of its reservation.
+    if (allowed(p, c))
+      classops(p) -> enqueue(rq, p, 0);
+    else
+      requeue = 1;
+  }
+  else
+    schedclass(p, cls, prio);
+  release(&rq -> lock);
+  if (requeue)
+    ready(p);
+  else if (c != cpu)
+    lapicipi(c -> id, T_IRQ0 + IRQ_WAKEUP);
+}
 
-  int i, index = -1;
-  for (i = 0; i < mlfq_size[level]; i++)
+// Lend run queue level lvl to p, or take back what was lent if lvl
+// is 0: p runs at lvl or its own level, whichever is higher.  A
+// queued p is requeued at its new level, and a cpu it is queued
+// on is sent an IPI to look at it.
+static void
+setpi(struct proc *p, int lvl)
+{
+  struct runq *rq;
+  struct cpu *c;
+
+  if ((rq = rq_lockproc(p)) == 0)
+  {
+    p -> pi_lvl = lvl;
+    return;
+  }
+  if (p -> rq == rq)
+  {
+    classops(p) -> dequeue(rq, p);
+    p -> pi_lvl = lvl;
+    classops(p) -> enqueue(rq, p, 0);
+  }
+  else
+    p -> pi_lvl = lvl;
+  release(&rq -> lock);
+  if ((c = rq_cpu(rq)) != cpu)
+    lapicipi(c -> id, T_IRQ0 + IRQ_WAKEUP);
+}
+
+// Move the proc with the given pid to scheduling class cls, at
+// real-time priority prio (0 to NRTPRIO-1, higher first) for
+// SCHED_RT.  The class is inherited by fork() and clone().
+// A deadline proc gives up its reservation.  Returns -1 if there
+// is no such proc or cls or prio is out of range; SCHED_DEADLINE
+// is entered with setdeadline().
+int
+setclass(int pid, int cls, int prio)
+{
+  struct proc *p;
+
+  if (cls < SCHED_NORMAL || cls > SCHED_BATCH)
+    return -1;
+  if (cls == SCHED_RT && (prio < 0 || prio >= NRTPRIO))
+    return -1;
+
+  acquire(&ptable.lock);
+  if ((p = pidlookup(pid)) == 0 || p -> state == ZOMBIE)
+  {
+    release(&ptable.lock);
+    return -1;
+  }
+  if (p -> class == SCHED_DEADLINE)
+    dl_reserved[p -> dl_cpu - cpus] -= dl_util(p);
+  chclass(p, cls, prio);
+  release(&ptable.lock);
+
+  if (p == proc)
+    yield();
+  return 0;
+}
+
+// Reserve budget ticks of every period ticks for the proc with
+// the given pid, moving it to the deadline class; it must use
+// them by the end of each period.  EDF runs on each cpu's own
+// queues, so the reservation is placed on one cpu p may run on,
+// the least reserved, and p only runs there; admission control
+// keeps the reservations on every cpu within DLLIMIT per mille.
+// Returns -1 if there is no such proc, the budget does not fit
+// in the period, or no cpu has room for it.
+int
+setdeadline(int pid, int budget, int period)
+{
+  struct proc *p;
+  struct cpu *c;
+  int share;
+
+  if (budget <= 0 || period < budget || period > DLMAXPERIOD)
+    return -1;
+
+  acquire(&ptable.lock);
+  if ((p = pidlookup(pid)) == 0 || p -> state == ZOMBIE)
+  {
+    release(&ptable.lock);
+    return -1;
+  }
+  if (p -> class == SCHED_DEADLINE)
+    dl_reserved[p -> dl_cpu - cpus] -= dl_util(p);
+  share = dl_share(budget, period);
+  if ((c = dl_place(share, p -> affinity)) == 0)
+  {
+    if (p -> class == SCHED_DEADLINE)
+      dl_reserved[p -> dl_cpu - cpus] += dl_util(p);
+    release(&ptable.lock);
+    return -1;
+  }
+  dl_reserved[c - cpus] += share;
+  p -> dl_cpu = c;
+  p -> dl_budget = budget;
+  p -> dl_period = period;
+  p -> dl_missed = 0;
+  chclass(p, SCHED_DEADLINE, 0);
+  release(&ptable.lock);
+
+  if (p == proc)
+    yield();
+  return 0;
+}
+
+// Called by trap() when the timer takes the cpu from proc in
+// user space.  If proc is a deadline proc that has used up its
+// budget, sleep until the next period starts (where dl_renew()
+// makes a fresh start) and return 1; otherwise return 0.  Procs
+// of a group over its quota need not sleep: they stay queued
+// and rq_pick() passes them over until grp_renew() starts its
+// next period.
+int
+throttle(void)
+{
+  uint until;
+
+  tickupdate();
+  if (proc -> class != SCHED_DEADLINE || proc -> dl_left != 0)
+    return 0;
+  until = proc -> dl_deadline;
+  acquire(&tickslock);
+  while ((int)(ticks - until) < 0 && !proc -> killed)
   {
-      if (p -> pid == mlfq[level][i] -> pid)
+    tickalarm(until);
+    sleep(&ticks, &tickslock);
+  }
+  release(&tickslock);
+  return 1;
+}
+
+// Move the proc with the given pid to bandwidth group grp (0 to
+// NGROUP-1).  The group is inherited by fork() and clone().
+// Returns -1 if there is no such proc or group.
+int
+setgroup(int pid, int grp)
+{
+  struct proc *p;
+
+  if (grp < 0 || grp >= NGROUP)
+    return -1;
+
+  acquire(&ptable.lock);
+  if ((p = pidlookup(pid)) == 0 || p -> state == ZOMBIE)
+  {
+    release(&ptable.lock);
+    return -1;
+  }
+  p -> grp = grp;
+  release(&ptable.lock);
+  return 0;
+}
+
+// Let the procs in group grp run for at most quota ticks, summed
+// over all cpus, in every period ticks, or without limit if quota
+// is 0.  Procs of a group over its quota are preempted at the
+// timer tick and not dispatched until the next period starts.  Group 0 has no quota.
+// Returns -1 if grp is out of range or 0, or quota or period is.
+int
+setquota(int grp, int quota, int period)
+{
+  struct group *g;
+
+  if (grp <= 0 || grp >= NGROUP || quota < 0 || period <= 0)
+    return -1;
+
+  g = &groups[grp];
+  acquire(&g -> lock);
+  g -> quota = quota;
+  g -> period = period;
+  g -> start = ticks;
+  g -> used = 0;
+  release(&g -> lock);
+  return 0;
+}
+
+// Switch to the scheduling policy called name.  Every proc is set
+// up afresh under the new policy, and queued normal ones are
+// requeued by it where they are; procs of other classes keep
+// their turn there, and are ready for the policy when they return
+// to the normal class (see schedclass()).  Meant for init at boot, but
+// safe at any time: holding every run queue lock (taken in cpu
+// order, after ptable.lock) keeps every other cpu out of the
+// policy while it changes.  Returns -1 if there is no such policy.
+int
+setsched(char *name)
+{
+  struct schedops *ops;
+  struct proc *p;
+  struct runq *rq;
+  struct cpu *c;
+  int t, w;
+
+  if ((ops = schedlookup(name)) == 0)
+    return -1;
+
+  acquire(&ptable.lock);
+  for (c = cpus; c < cpus+ncpu; c++)
+    acquire(&c -> rq.lock);
+  if (ops != schedops && (p = ptable.head) != 0)
+  {
+    do {
+      if (p -> class != SCHED_NORMAL)
       {
-        index = i; // location of p found in its level
-        break;
+        t = p -> ticks_curr;
+        w = p -> wait_ticks_curr;
+        ops->init(p);
+        p -> ticks_curr = t;
+        p -> wait_ticks_curr = w;
+        continue;
       }
+      if ((rq = p -> rq) != 0)
+        schedops->dequeue(rq, p);
+      ops->init(p);
+      if (rq != 0)
+        ops->enqueue(rq, p, 0);
+    } while ((p = p -> tbl_next) != ptable.head);
   }
-  if (index == -1)
-    return 0; // location of p not found
-  
-  // Removing p from current level:
-  rm_priority(level, index);
+  schedops = ops;
+  for (c = cpus+ncpu; c-- > cpus; )
+    release(&c -> rq.lock);
+  release(&ptable.lock);
+  return 0;
+}
 
-  // Add p to higher level:
-  mlfq[level+1][mlfq_size[level+1]] = p;
-    mlfq_size[level+1] += 1;
-  
-  // Change p's members:
-  p -> ticks_curr = 0;
-  p -> wait_ticks_curr = 0;
-  p -> wait_ticks[level] = 0; // Bad idea
-  p -> level += 1;
+// Copy the MLFQ parameters to old, unless it is 0, and then install
+// those in new, unless it is 0.  New parameters take effect at once
+// for every proc: with every run queue lock held, procs above the
+// levels in use are moved down to the top one, and queued procs
+// are requeued so their boost deadlines follow the new time slices
+// and aging threshold.  Returns -1 if new is not usable.
+int
+setmlfq(struct mlfqparam *old, struct mlfqparam *new)
+{
+  struct proc *p;
+  struct runq *rq;
+  struct cpu *c;
+
+  if (new && mlfq_check(new) < 0)
+    return -1;
+
+  acquire(&ptable.lock);
+  for (c = cpus; c < cpus+ncpu; c++)
+    acquire(&c -> rq.lock);
+  if (old)
+    mlfq_get(old);
+  if (new)
+  {
+    mlfq_set(new);
+    if ((p = ptable.head) != 0)
+    {
+      do {
+        if ((rq = p -> rq) != 0 && p -> class == SCHED_NORMAL)
+          schedops->dequeue(rq, p);
+        else
+          rq = 0;
+        if (p -> level >= new -> nlevel)
+          p -> level = new -> nlevel - 1;
+        if (rq != 0)
+          schedops->enqueue(rq, p, 0);
+      } while ((p = p -> tbl_next) != ptable.head);
+    }
+  }
+  for (c = cpus+ncpu; c-- > cpus; )
+    release(&c -> rq.lock);
+  release(&ptable.lock);
+  return 0;
+}
+
+// This system call boost the current process to one higher priority level
+// (under the MLFQ; other policies boost it in their own way, if at all).
+int 
+boostproc(void)
+{
+  struct proc *p = proc; // p points to current process
+
+  acquire(&ptable.lock);
+  if (classops(p)->boost)
+  {
+    // p is RUNNING, so it is not on any run queue and the
+    // scheduler will requeue it at its new level.  Its time
+    // slice may start over there, so re-arm the timer.
+    acquire(&cpu->rq.lock);
+    rq_sync(&cpu->rq, p);
+    classops(p)->boost(p);
+    schedarm(&cpu->rq, p);
+    release(&cpu->rq.lock);
+  }
+  release(&ptable.lock);
 
 	return 0;
 }
@@ -887,25 +2291,38 @@ munprotect(void *addr, int len)
 
 // Semaphore-related systemcalls below:
 
-// Wake up all processes sleeping on chan.
-void
-wakeup2(void *chan)
+// The highest run queue level lent to p by the waiters of the
+// mutexes it holds, or 0.
+static int
+sem_pi(struct proc *p)
 {
-  acquire(&ptable.lock);
-  struct proc *p;
+  int i, lvl = 0;
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-    
-    // Check if the proc is sleeping and is sleeping on this channel:
-    int* pchan_buff = (int*)(p->chan);
-    int* chan_buff = (int*)chan;
-    
-    if(p->state == SLEEPING && *pchan_buff == *chan_buff) {
-      p->state = RUNNABLE; // let scheduler consider p to run next time
-      //break;
-    } 
+  for (i = 0; i < NUM_SEMAPHORES; i++)
+    if (sem_list[i].holder == p && sem_list[i].pi > lvl)
+      lvl = sem_list[i].pi;
+  return lvl;
+}
+
+// Forget that the exiting proc p holds any mutex, so that its
+// waiters do not lend their level to a freed proc.
+static void
+sem_drop(struct proc *p)
+{
+  struct semaphore *sem;
+
+  for (sem = sem_list; sem < sem_list + NUM_SEMAPHORES; sem++)
+  {
+    if (sem -> holder != p)
+      continue;
+    acquire(&sem -> splock);
+    if (sem -> holder == p)
+    {
+      sem -> holder = 0;
+      sem -> pi = 0;
+    }
+    release(&sem -> splock);
   }
-  release(&ptable.lock);
 }
 
 // Initialize one semaphore
@@ -931,6 +2348,9 @@ sem_init(int* sem_id, int count)
       sem -> id = *sem_id;
       sem -> value = count;
       sem -> used = 1;
+      sem -> mutex = (count == 1);
+      sem -> holder = 0;
+      sem -> pi = 0;
       initlock(&sem->splock, "SemaSpinLock");
 
       num_sem ++;
@@ -948,10 +2368,13 @@ sem_init(int* sem_id, int count)
 
 // Decrement sem->value, 
 // put current thread to sleep if non-positive. 
+// A semaphore created with a count of 1 is taken to be a mutex:
+// its holder runs at the run queue level of its highest waiter,
+// if that is higher than its own, until it posts it.
 int 
 sem_wait(int sem_id)
 { 
-  int foundSem = 0;
+  int foundSem = 0, lvl;
   struct semaphore* sem = &sem_list[sem_id];
   if (sem -> id == sem_id && sem -> used == 1)
   {
@@ -959,13 +2382,27 @@ sem_wait(int sem_id)
 
     acquire(&(sem -> splock));
     
-    while (sem -> value <= 0)
+    while (sem -> value <= 0 && sem -> used)
     {
-      sleep(&sem, &(sem -> splock));
-        // use &sem (unique for each sem) as channel so thread
+      if (sem -> holder && (lvl = rq_level(proc)) > sem -> pi)
+      {
+        sem -> pi = lvl;
+        if (lvl > sem -> holder -> pi_lvl)
+          setpi(sem -> holder, lvl);
+      }
+      sleep(sem, &(sem -> splock));
+        // use sem (unique for each sem) as channel so thread
         // remembers which sem it is waiting for while sleeping 
     }
+    // Destroyed while we slept.
+    if (!sem -> used)
+    {
+      release(&(sem -> splock));
+      return -1;
+    }
     sem -> value -= 1;
+    if (sem -> mutex)
+      sem -> holder = proc;
 
     release(&(sem -> splock));
   }
@@ -978,22 +2415,37 @@ sem_wait(int sem_id)
 
 // Increment sem->value
 // and wake up all threads sleeping on this sem.
+// A mutex's holder gives back any level its waiters lent it.
 int
 sem_post(int sem_id)
 {
   int foundSem = 0;
   struct semaphore* sem = &sem_list[sem_id];
+  struct proc *holder;
+  int lent = 0;
+
   if (sem -> id == sem_id && sem -> used == 1)
   {
     foundSem = 1;
 
     acquire(&(sem -> splock));
 
+    if ((holder = sem -> holder) != 0)
+    {
+      sem -> holder = 0;
+      sem -> pi = 0;
+      if ((lent = holder -> pi_lvl) != 0)
+        setpi(holder, sem_pi(holder));
+    }
     sem -> value += 1;
-    wakeup2(&sem);
+    wakeup(sem);
     // wakes all threads waiting for this semaphore
     
     release(&(sem -> splock));
+
+    // Make way for a waiter that lent us its level.
+    if (holder == proc && lent)
+      yield();
   }
   
   if (foundSem == 0)
@@ -1002,17 +2454,31 @@ sem_post(int sem_id)
   return 0;
 }
 
-// Destroy the semaphore with sem_id.
+// Destroy the semaphore with sem_id.  Procs waiting on it
+// wake up and their sem_wait() returns -1.
 int
 sem_destroy(int sem_id)
 {
   int foundSem = 0;
   struct semaphore* sem = &sem_list[sem_id];
+  struct proc *holder;
   if (sem -> id == sem_id)
   {
     foundSem = 1;
     acquire(&lock_semlist);
+    acquire(&(sem -> splock));
     sem -> used = 0;
+    // Give back any level the holder was lent, as sem_post()
+    // does, and wake the waiters so sem_wait() fails for them.
+    if ((holder = sem -> holder) != 0)
+    {
+      sem -> holder = 0;
+      sem -> pi = 0;
+      if (holder -> pi_lvl != 0)
+        setpi(holder, sem_pi(holder));
+    }
+    wakeup(sem);
+    release(&(sem -> splock));
     release(&lock_semlist);
   }
   if (foundSem == 0)
@@ -1024,28 +2490,25 @@ int
 getfilenum(int pid)
 {
 	struct proc *p;
-	if (pid == 0) {
+	int fd;
+	int filenum = 0;
+
+	acquire(&ptable.lock);
+	if ((p = pidlookup(pid)) == 0)
+	{
+		release(&ptable.lock);
 		return -1;
 	}
-	for (p = ptable.proc; p < &ptable.proc[NPROC]; p++) 
+
+	// Find number of files opened 
+	// from file descriptor: 
+	for (fd = 0; fd < NOFILE; fd++) 
 	{
-		if (p -> pid == pid) 
+		if (p -> ofile[fd] != 0) 
 		{
-
-			// Find number of files opened 
-			// from file descriptor: 
-			int fd;
-			int filenum = 0;
-			//prinf(1, "NOFILE = %d\n", NOFILE);
-			for (fd = 0; fd < NOFILE; fd++) 
-			{
-				if (p -> ofile[fd] != 0) 
-				{
-					filenum++;
-				}
-			}
-			return filenum;
+			filenum++;
 		}
 	}
-	return -1;
+	release(&ptable.lock);
+	return filenum;
 }
\ No newline at end of file
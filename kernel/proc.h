@@ -1,5 +1,7 @@
 #ifndef _PROC_H_
 #define _PROC_H_
+#include "spinlock.h"
+
 // Segments in proc->gdt.
 // Also known to bootasm.S and trapasm.S
 #define SEG_KCODE 1  // kernel code
@@ -10,6 +12,62 @@
 #define SEG_TSS   6  // this process's task state
 #define NSEGS     7
 
+// Per-CPU run queues.
+// Each level is a circular doubly-linked list of RUNNABLE procs,
+// threaded through p->rq_next/rq_prev, with queue[lvl] as its head.
+// Bit lvl of mask is set while level lvl is non-empty, so the
+// highest runnable level is found without scanning.
+// Waiting is measured in dispatches: every queued proc waits one
+// tick each time this cpu dispatches, so a proc's wait is just
+// clock minus the clock value stamped on it when it was queued.
+// Which levels procs are queued at, and in what order, is up to
+// their scheduling class (see struct schedops): lowest first, the
+// batch class, the NLAYER levels of the normal class, one level
+// per real-time priority, then the deadline class.
+#define QBATCH   0
+#define QNORMAL  1
+#define QRT      (QNORMAL + NLAYER)
+#define QDL      (QRT + NRTPRIO)
+#define NQUEUE   (QDL + 1)
+
+// Queued procs that share a page table are counted by a hash of
+// it, so gang scheduling can tell cheaply whether a cpu has a
+// sibling of a proc queued (see rq_gang()).
+#define NGANGHASH 32
+#define GANGHASH(p) ((uint)(unsigned long)(p)->pgdir / PGSIZE % NGANGHASH)
+
+struct runq {
+  struct spinlock lock;        // Protects the queues and the procs on them
+  struct proc *queue[NQUEUE];  // Head of each priority level
+  uint mask;                   // Non-empty levels
+  int nrun;                    // Number of queued procs
+  uint clock;                  // Number of dispatches from this queue
+  uint age[NLAYER];            // MLFQ: no proc at a level is due a boost before this clock
+  uint pass;                   // Stride: pass of the proc last dispatched
+  int ngang;                   // Queued procs that share a page table
+  ushort gang[NGANGHASH];      // Of which with each GANGHASH
+  int parked;                  // nrun when only procs of throttled groups were queued
+  uint parkend;                // ticks when the first of their groups may run again
+};
+
+// A scheduling class or policy (see sched.c).  All ops are called with the
+// lock of the run queue involved held; for a running proc, that of
+// the cpu it runs on.  charge, tick, wakeup and boost may be 0.
+struct schedops {
+  char *name;
+  void (*init)(struct proc*);                       // Set up a new proc, or one taken over from another policy
+  void (*enqueue)(struct runq*, struct proc*, int); // Queue p; at the head of its turn if the int is non-zero
+  void (*dequeue)(struct runq*, struct proc*);      // Unqueue p
+  struct proc *(*pick_next)(struct runq*);          // The proc to run next, still queued, or 0
+  void (*charge)(struct proc*, uint);               // The running proc has run n more ticks
+  void (*tick)(struct runq*);                       // Timer tick work on the queues, such as aging
+  int (*preempt)(struct runq*, struct proc*);       // Should the running proc give way at this tick?
+  uint (*nexttick)(struct runq*, struct proc*);     // Ticks until preempt() may say so, 0 for never
+  int (*stop)(struct proc*);                        // The running proc gives up the cpu; 1 if its turn is over
+  void (*wakeup)(struct runq*, struct proc*);       // A sleeping proc is about to be queued
+  void (*boost)(struct proc*);                      // boostproc() on the running proc
+};
+
 // Per-CPU state
 struct cpu {
   uchar id;                    // Local APIC ID; index into cpus[] below
@@ -23,6 +81,19 @@ struct cpu {
   // Cpu-local storage variables; see below
   struct cpu *cpu;
   struct proc *proc;           // The currently-running process.
+  struct proc *prev;           // Proc just switched away from (see sched())
+
+  struct runq rq;              // Procs waiting to run on this cpu
+  volatile int idle;           // Halted in scheduler() with nothing to run
+  uint idle_start;             // ticks when the cpu last went idle
+  uint idle_ticks;             // Total ticks spent idle
+  uint migrations;             // Procs dispatched here that last ran elsewhere
+
+  // Dynamic ticks (see lapicarm())
+  uint tmr_init;               // Count the timer was last armed with, 0 if stopped
+  uint tmr_off;                // Counts into a tick when it was armed
+  uint tmr_seen;               // Ticks since then reported by lapicticks()
+  int tmr_far;                 // Armed more than one tick ahead for proc
 };
 
 extern struct cpu cpus[NCPU];
@@ -82,6 +153,45 @@ struct proc {
   int wait_ticks[NLAYER];		   // Timer ticks it has wait in MLFQ
   int ticks_curr;              // Timer ticks at current priority level
   int wait_ticks_curr;         // Timer ticks waited at current priority level
+  struct proc *rq_next;        // Next proc in its level's run queue
+  struct proc *rq_prev;        // Previous proc in its level's run queue
+  volatile int oncpu;          // If non-zero, context is live on some cpu
+  struct runq *rq;             // Run queue p is on, or 0
+  int rq_lvl;                  // Level of rq p is on
+  uint rq_stamp;               // rq->clock when p was queued
+  int rq_gang;                 // Counted in rq->gang while queued
+  struct cpu *lastcpu;         // Cpu p last ran on, or 0
+  uint lastrun;                // ticks when p last left a cpu
+  int migrations;              // Times p was dispatched away from lastcpu
+  int affinity;                // Mask of cpus (by index into cpus[]) p may run on
+  int class;                   // Scheduling class (SCHED_NORMAL etc.)
+  int rtprio;                  // Priority in the real-time class
+  int dl_budget;               // Deadline: ticks reserved every period
+  int dl_period;               // Deadline: length of a period, in ticks
+  int dl_left;                 // Deadline: budget left in this period
+  uint dl_deadline;            // Deadline: ticks at which this period ends
+  int dl_missed;               // Deadline: periods that ended short of budget
+  struct cpu *dl_cpu;          // Deadline: cpu the reservation is on, and p runs on
+  int grp;                     // Bandwidth group (see setquota())
+  int pi_lvl;                  // Run queue level lent by semaphore waiters, or 0
+  int iowait;                  // Sleeping in sleepio()
+  int iofront;                 // Woken from I/O: queue ahead of its level's peers
+  int sliceout;                // MLFQ: used up its slice when it last gave up the cpu
+  uint ioboost_at;             // ticks when an I/O wakeup last raised its level
+  int ioboosts;                // Times woken from I/O ahead of its peers
+  int tickets;                 // Stride: share of the cpu
+  uint pass;                   // Stride: virtual time p has run to
+  struct proc *wq_next;        // Next proc sleeping in the same wait queue
+  struct proc *wq_prev;        // Previous proc sleeping in the same wait queue
+  struct proc *children;       // Forked children, zombies first
+  struct proc *threads;        // Cloned threads, zombies first
+  struct proc *sib_next;       // Next proc on the parent's list
+  struct proc *sib_prev;       // Previous proc on the parent's list
+  struct proc **sib_head;      // The parent's list p is on
+  int isthread;                // Created by clone(); shares its parent's pgdir
+  struct proc *pid_next;       // Next proc in the same pid hash chain
+  struct proc *tbl_next;       // Next proc in the process table, by pid
+  struct proc *tbl_prev;       // Previous proc in the process table
 };
 
 // Process memory is laid out contiguously, low addresses first:
@@ -3,17 +3,22 @@
 unsigned int rand_seed = 1;
 
 /* The state word must be initialized to non-zero */
-int xv6_rand()
+int xv6_rand_r(unsigned int *state)
 {
 	/* Algorithm "xor" from p. 4 of Marsaglia, "Xorshift RNGs" */
-	unsigned int x = rand_seed;
+	unsigned int x = *state;
 	x ^= x << 13;
 	x ^= x >> 17;
 	x ^= x << 5;
-	rand_seed = x;
+	*state = x;
 	return x % XV6_RAND_MAX;
 }
 
+int xv6_rand()
+{
+	return xv6_rand_r(&rand_seed);
+}
+
 void 
 xv6_srand (unsigned int seed)
 {
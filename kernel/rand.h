@@ -9,6 +9,12 @@
 */
 int xv6_rand (void);
 
+/* 
+    Like xv6_rand, but with the state word *state, which must be non-zero, instead of
+    the shared one, so callers that each keep their own need no lock between them.
+*/
+int xv6_rand_r (unsigned int *state);
+
 /* 
     The xv6_srand function uses the argument as a seed for a new sequence of pseudo-random numbers to be returned by subsequent calls to rand.
     If xv6_srand is then called with the same seed value, the sequence of pseudo-random numbers shall be repeated.
@@ -0,0 +1,881 @@
+// Scheduling classes and policies.
+//
+// proc.c decides which cpu a proc is queued on and when a cpu
+// switches; the ops of a proc's class decide at which level of a
+// cpu's run queue (see struct runq) it waits and where, and when
+// it has had its turn.  Every class keeps its procs in the levels
+// of the run queue, so the placement code in proc.c can walk
+// them, and the highest non-empty level always runs first.
+//
+// The real-time class sits above the normal class and the batch
+// class below it, and the deadline class above them all (see
+// QBATCH in proc.h).  Normal procs follow the
+// policy in schedops, chosen at boot: SCHEDPOLICY in param.h,
+// unless init finds another named in /sched (see setsched()).
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "pstat.h"
+
+struct schedops *schedops;
+
+// Run queue levels, shared by the classes and policies.
+
+// The run queue level p waits at, given its class, or the level
+// lent to it by procs waiting for a semaphore it holds, if higher.
+int
+rq_level(struct proc *p)
+{
+  int lvl;
+
+  if(p->class == SCHED_RT)
+    lvl = QRT + p->rtprio;
+  else if(p->class == SCHED_BATCH)
+    lvl = QBATCH;
+  else if(p->class == SCHED_DEADLINE)
+    lvl = QDL;
+  else
+    lvl = QNORMAL + p->level;
+  return p->pi_lvl > lvl ? p->pi_lvl : lvl;
+}
+
+// Insert p at its level before next, a proc queued at that level,
+// or at the tail if next is 0 or at another level (as when p runs
+// at a lent level, see sem_wait()), stamping it with the clock so that
+// rq_remove() can charge it for its wait.
+// Caller must hold rq->lock.
+void
+rq_insert(struct runq *rq, struct proc *p, struct proc *next)
+{
+  int lvl = rq_level(p);
+  struct proc *head = rq->queue[lvl];
+
+  if(next != 0 && next->rq_lvl != lvl)
+    next = 0;
+  p->rq = rq;
+  p->rq_lvl = lvl;
+  p->rq_stamp = rq->clock;
+  p->rq_gang = p->isthread || p->threads != 0;
+  if(p->rq_gang){
+    rq->ngang++;
+    rq->gang[GANGHASH(p)]++;
+  }
+  if(head == 0){
+    p->rq_next = p;
+    p->rq_prev = p;
+    rq->queue[lvl] = p;
+    rq->mask |= 1 << lvl;
+  } else {
+    if(next == 0)
+      next = head;
+    else if(next == head)
+      rq->queue[lvl] = p;
+    p->rq_next = next;
+    p->rq_prev = next->rq_prev;
+    next->rq_prev->rq_next = p;
+    next->rq_prev = p;
+  }
+  rq->nrun++;
+}
+
+// Append p to the tail of the run queue of its level.
+// Caller must hold rq->lock.
+void
+rq_append(struct runq *rq, struct proc *p)
+{
+  rq_insert(rq, p, 0);
+}
+
+// Insert p at the head of its level so that it runs next.
+// Caller must hold rq->lock.
+void
+rq_push(struct runq *rq, struct proc *p)
+{
+  rq_append(rq, p);
+  rq->queue[p->rq_lvl] = p;
+}
+
+// Unlink p from the run queue of its level and charge it
+// for the time it waited there.
+// p->level must not change while p is queued.
+// Caller must hold rq->lock.
+void
+rq_remove(struct runq *rq, struct proc *p)
+{
+  int lvl = p->rq_lvl;
+  uint waited = rq->clock - p->rq_stamp;
+
+  p->wait_ticks[p->level] += waited;
+  p->wait_ticks_curr += waited;
+
+  if(p->rq_next == p){
+    rq->queue[lvl] = 0;
+    rq->mask &= ~(1 << lvl);
+  } else {
+    p->rq_prev->rq_next = p->rq_next;
+    p->rq_next->rq_prev = p->rq_prev;
+    if(rq->queue[lvl] == p)
+      rq->queue[lvl] = p->rq_next;
+  }
+  p->rq_next = 0;
+  p->rq_prev = 0;
+  p->rq = 0;
+  rq->nrun--;
+  if(p->rq_gang){
+    rq->ngang--;
+    rq->gang[GANGHASH(p)]--;
+  }
+}
+
+// Return the proc at the head of the highest non-empty level,
+// or 0 if nothing is runnable.  Caller must hold rq->lock.
+struct proc*
+rq_highest(struct runq *rq)
+{
+  if(rq->mask == 0)
+    return 0;
+  return rq->queue[31 - __builtin_clz(rq->mask)];
+}
+
+// Start proc p's turns afresh at the time slice of its level.
+static void
+newslice(struct proc *p)
+{
+  p -> ticks_curr = 0;
+  p -> wait_ticks_curr = 0;
+}
+
+/* Added by Roxin Liu: */
+
+// Multi-level feedback queue: see README.txt.
+
+// The parameters are tunable at run time (see setmlfq()).  Only
+// the bottom mlfq_nlevel levels are in use; procs start at the
+// top one of those.
+int limit_total[NLAYER] = {64, 32, 16, 8};
+int limit_rr[NLAYER] = {64, 4, 2, 1};
+int mlfq_nlevel = NLAYER;
+int mlfq_aging = 10;      // Waiting this many time slices earns a boost
+
+// The rq clock value at which p will have waited mlfq_aging
+// times the time slice of its level since it was last dispatched.
+static uint
+mlfq_deadline(struct proc *p)
+{
+  return p->rq_stamp + mlfq_aging * limit_total[p->level] - p->wait_ticks_curr;
+}
+
+// New procs start at the highest level.
+static void
+mlfq_init(struct proc *p)
+{
+  p -> level = mlfq_nlevel - 1;
+  newslice(p);
+}
+
+// Queue p at the tail of its level, or at the head if it keeps
+// its round-robin turn or has just woken from I/O, and note when
+// it is due a boost.
+static void
+mlfq_enqueue(struct runq *rq, struct proc *p, int front)
+{
+  uint deadline;
+  int lvl = p -> level;
+
+  if (front || p -> iofront)
+    rq_push(rq, p);
+  else
+    rq_append(rq, p);
+  p -> iofront = 0;
+  deadline = mlfq_deadline(p);
+  if (p -> rq_next == p || (int)(deadline - rq->age[lvl]) < 0)
+    rq->age[lvl] = deadline;
+}
+
+// Promote every proc queued on rq that has waited mlfq_aging
+// times the time slice of its current level by one level.  A level is only walked
+// once the clock reaches the earliest deadline recorded for it,
+// which is then recomputed.  Caller must hold rq->lock.
+static void
+mlfq_age(struct runq *rq)
+{
+  struct proc *p, *next, *tail;
+  int lvl, last, due;
+  uint deadline, earliest;
+
+  // The top level cannot be boosted any further.
+  for (lvl = mlfq_nlevel-2; lvl >= 0; lvl--)
+  {
+    if ((p = rq->queue[QNORMAL+lvl]) == 0 || (int)(rq->clock - rq->age[lvl]) < 0)
+      continue;
+    tail = p -> rq_prev;
+    due = 0;
+    earliest = 0;
+    for (;;)
+    {
+      next = p -> rq_next;
+      last = (p == tail);
+      deadline = mlfq_deadline(p);
+
+      // Check if p has waited mlfq_aging times the time slice in its current level:
+      if ((int)(rq->clock - deadline) >= 0)
+      {
+        rq_remove(rq, p);
+        newslice(p);
+        p -> wait_ticks[lvl] = 0; // Bad idea
+        p -> level += 1;
+        mlfq_enqueue(rq, p, 0);
+      }
+      else if (!due || (int)(deadline - earliest) < 0)
+      {
+        due = 1;
+        earliest = deadline;
+      }
+      if (last)
+        break;
+      p = next;
+    }
+    if (due)
+      rq->age[lvl] = earliest;
+  }
+}
+
+// Would the MLFQ switch the running proc p out at this tick?
+static int
+mlfq_preempt(struct runq *rq, struct proc *p)
+{
+  int lvl = p -> level;
+
+  if (lvl > 0 && p -> ticks_curr >= limit_total[lvl])
+    return 1;
+  return rq->queue[QNORMAL+lvl] && (p -> ticks_curr % limit_rr[lvl]) == 0;
+}
+
+// Number of ticks from now until the first one at which the
+// MLFQ has something to do for the running proc p: the end of
+// its time slice, its round-robin turn if it has peers, or the
+// next aging check.  (A higher level becoming non-empty is
+// handled for every class by proc.c.)
+static uint
+mlfq_nexttick(struct runq *rq, struct proc *p)
+{
+  int lvl = p -> level, l, rr;
+  uint t = p -> ticks_curr, n, m;
+
+  n = 0;
+  if (lvl > 0)
+    n = t < limit_total[lvl] ? limit_total[lvl] - t + 1 : 1;
+  if (rq->queue[QNORMAL+lvl])
+  {
+    rr = limit_rr[lvl];
+    m = (rr - t % rr) % rr + 1;
+    if (n == 0 || m < n)
+      n = m;
+  }
+  for (l = 0; l < mlfq_nlevel-1; l++)
+  {
+    if (rq->queue[QNORMAL+l] == 0)
+      continue;
+    m = (int)(rq->age[l] - rq->clock) < 0 ? 1 : rq->age[l] - rq->clock + 1;
+    if (n == 0 || m < n)
+      n = m;
+  }
+  return n;
+}
+
+// The current proc is giving up the cpu after the tick it has
+// just run.  Demotes it once it has used up the time slice of its
+// level, noting that in p->sliceout, since the new slice it gets
+// hides it from mlfq_wakeup().  Returns 1 if it should go to the tail of its level (new
+// level or round-robin slice used up), 0 if it keeps its place at
+// the head.
+static int
+mlfq_stop(struct proc *p)
+{
+  int lvl = p -> level;
+
+  // Downgrading:
+  p -> sliceout = lvl > 0 && p -> ticks_curr >= limit_total[lvl];
+  if (p -> sliceout)
+  {
+    newslice(p);
+    p -> wait_ticks[lvl] = 0; // Bad idea
+    p -> level = lvl - 1;
+    return 1;
+  }
+
+  // Round robin:
+  return (p -> ticks_curr % limit_rr[lvl]) == 0;
+}
+
+// Raise the running proc p one level, unless it is at the top.
+// Its time slice starts over there.
+static void
+mlfq_boost(struct proc *p)
+{
+  int level = p -> level;
+
+  if (level < mlfq_nlevel-1) // Do not boost at highest level
+  {
+    newslice(p);
+    p -> wait_ticks[level] = 0; // Bad idea
+    p -> level += 1;
+  }
+}
+
+// Interactive boost: p, which blocked on I/O (see sleepio()), is
+// about to be queued on rq.  If it blocked before using up the time
+// slice of its level, it goes ahead of the CPU-bound procs at its
+// level, and up a level, no higher than ioboost_top and at most
+// once every ioboost_gap ticks so that a proc doing a little I/O
+// between long bursts cannot climb for free.
+int ioboost_top = IOBOOSTTOP;
+int ioboost_gap = IOBOOSTGAP;
+
+static void
+mlfq_wakeup(struct runq *rq, struct proc *p)
+{
+  int lvl = p -> level;
+
+  if (!p -> iowait)
+    return;
+  p -> iowait = 0;
+  if (p -> sliceout)
+    return;
+  p -> iofront = 1;
+  p -> ioboosts++;
+  if (lvl < ioboost_top && lvl < mlfq_nlevel-1 &&
+      (int)(ticks - p -> ioboost_at) >= ioboost_gap)
+  {
+    p -> ioboost_at = ticks;
+    newslice(p);
+    p -> wait_ticks[lvl] = 0; // Bad idea
+    p -> level = lvl + 1;
+  }
+}
+
+// Copy the MLFQ parameters to mp.
+void
+mlfq_get(struct mlfqparam *mp)
+{
+  int l;
+
+  mp -> nlevel = mlfq_nlevel;
+  for (l = 0; l < NLAYER; l++)
+  {
+    mp -> slice[l] = limit_total[l];
+    mp -> rr[l] = limit_rr[l];
+  }
+  mp -> aging = mlfq_aging;
+  mp -> ioboost_top = ioboost_top;
+  mp -> ioboost_gap = ioboost_gap;
+}
+
+// Are the MLFQ parameters in mp usable?  Returns 0 if so.
+int
+mlfq_check(struct mlfqparam *mp)
+{
+  int l;
+
+  if (mp -> nlevel < 1 || mp -> nlevel > NLAYER)
+    return -1;
+  for (l = 0; l < NLAYER; l++)
+    if (mp -> slice[l] < 1 || mp -> rr[l] < 1)
+      return -1;
+  if (mp -> aging < 1 || mp -> ioboost_gap < 0)
+    return -1;
+  if (mp -> ioboost_top < 0 || mp -> ioboost_top >= mp -> nlevel)
+    return -1;
+  return 0;
+}
+
+// Install the MLFQ parameters in mp, checked by mlfq_check().
+// Caller must hold every run queue lock, and requeue the procs.
+void
+mlfq_set(struct mlfqparam *mp)
+{
+  int l;
+
+  mlfq_nlevel = mp -> nlevel;
+  for (l = 0; l < NLAYER; l++)
+  {
+    limit_total[l] = mp -> slice[l];
+    limit_rr[l] = mp -> rr[l];
+  }
+  mlfq_aging = mp -> aging;
+  ioboost_top = mp -> ioboost_top;
+  ioboost_gap = mp -> ioboost_gap;
+}
+
+static struct schedops mlfq_ops = {
+  .name = "mlfq",
+  .init = mlfq_init,
+  .enqueue = mlfq_enqueue,
+  .dequeue = rq_remove,
+  .pick_next = rq_highest,
+  .tick = mlfq_age,
+  .preempt = mlfq_preempt,
+  .nexttick = mlfq_nexttick,
+  .stop = mlfq_stop,
+  .wakeup = mlfq_wakeup,
+  .boost = mlfq_boost,
+};
+
+// Fixed-level round robin, shared by the rr policy and the
+// real-time and batch classes: a proc runs for slice ticks at a
+// time, then gives way to the procs queued at its level.
+
+static void
+fifo_enqueue(struct runq *rq, struct proc *p, int front)
+{
+  if(front)
+    rq_push(rq, p);
+  else
+    rq_append(rq, p);
+}
+
+static int
+fifo_preempt(struct runq *rq, struct proc *p, int slice)
+{
+  return rq->queue[rq_level(p)] && p->ticks_curr % slice == 0;
+}
+
+static uint
+fifo_nexttick(struct runq *rq, struct proc *p, int slice)
+{
+  if(rq->queue[rq_level(p)] == 0)
+    return 0;
+  return (slice - p->ticks_curr % slice) % slice + 1;
+}
+
+// Round robin: every proc waits in one FIFO at level 0 and runs
+// for RRSLICE ticks at a time, like the original xv6 scheduler
+// did with RRSLICE 1.
+
+#define RRSLICE 1
+
+static void
+rr_init(struct proc *p)
+{
+  p->level = 0;
+  newslice(p);
+}
+
+static int
+rr_preempt(struct runq *rq, struct proc *p)
+{
+  return fifo_preempt(rq, p, RRSLICE);
+}
+
+static uint
+rr_nexttick(struct runq *rq, struct proc *p)
+{
+  return fifo_nexttick(rq, p, RRSLICE);
+}
+
+static int
+rr_stop(struct proc *p)
+{
+  return p->ticks_curr % RRSLICE == 0;
+}
+
+static struct schedops rr_ops = {
+  .name = "rr",
+  .init = rr_init,
+  .enqueue = fifo_enqueue,
+  .dequeue = rq_remove,
+  .pick_next = rq_highest,
+  .preempt = rr_preempt,
+  .nexttick = rr_nexttick,
+  .stop = rr_stop,
+};
+
+// Stride scheduling: each proc holds tickets and advances its
+// pass by STRIDE1/tickets for every tick it runs; the proc with
+// the lowest pass runs next, so procs share the cpu in proportion
+// to their tickets.  Level 0 is kept sorted by pass.  rq->pass,
+// the pass of the proc last dispatched, is the queue's virtual
+// time: a proc that slept or comes from another cpu starts no
+// further back than that, so it cannot make up for lost time.
+// boostproc() doubles a proc's tickets.
+
+#define STRIDE1     (1 << 16)
+#define TICKETS     100   // tickets a proc starts with
+#define MAXTICKETS  6400
+
+static void
+stride_init(struct proc *p)
+{
+  p->level = 0;
+  p->tickets = TICKETS;
+  p->pass = 0;
+  newslice(p);
+}
+
+static void
+stride_enqueue(struct runq *rq, struct proc *p, int front)
+{
+  struct proc *head, *q;
+
+  if((int)(p->pass - rq->pass) < 0)
+    p->pass = rq->pass;
+  // Behind every proc with the same pass, so equal procs
+  // take turns whether or not p is keeping its turn.  A proc
+  // lent a higher level (see rq_level()) is among its procs.
+  q = 0;
+  if((head = rq->queue[rq_level(p)]) != 0){
+    q = head;
+    while((int)(q->pass - p->pass) <= 0)
+      if((q = q->rq_next) == head){
+        q = 0;
+        break;
+      }
+  }
+  rq_insert(rq, p, q);
+}
+
+static void
+stride_dequeue(struct runq *rq, struct proc *p)
+{
+  if(p == rq->queue[QNORMAL])
+    rq->pass = p->pass;
+  rq_remove(rq, p);
+}
+
+static void
+stride_charge(struct proc *p, uint n)
+{
+  p->pass += n * (STRIDE1 / p->tickets);
+}
+
+static int
+stride_preempt(struct runq *rq, struct proc *p)
+{
+  struct proc *head = rq->queue[QNORMAL];
+
+  return head && (int)(head->pass - p->pass) < 0;
+}
+
+// The first tick at which p's pass will have overtaken the
+// head's, counting the tick p is running now.
+static uint
+stride_nexttick(struct runq *rq, struct proc *p)
+{
+  struct proc *head = rq->queue[QNORMAL];
+  int d;
+
+  if(head == 0)
+    return 0;
+  if((d = head->pass - p->pass) < 0)
+    return 1;
+  return d / (STRIDE1 / p->tickets) + 2;
+}
+
+static int
+stride_stop(struct proc *p)
+{
+  return 1;
+}
+
+static void
+stride_boost(struct proc *p)
+{
+  if(p->tickets < MAXTICKETS)
+    p->tickets *= 2;
+}
+
+static struct schedops stride_ops = {
+  .name = "stride",
+  .init = stride_init,
+  .enqueue = stride_enqueue,
+  .dequeue = stride_dequeue,
+  .pick_next = rq_highest,
+  .charge = stride_charge,
+  .preempt = stride_preempt,
+  .nexttick = stride_nexttick,
+  .stop = stride_stop,
+  .boost = stride_boost,
+};
+
+// The real-time class: fixed priorities 0 to NRTPRIO-1, above
+// every normal proc, higher first; procs at one priority take
+// turns every RTSLICE ticks.  A real-time proc keeps its normal
+// MLFQ level, unchanged, for when it leaves the class.
+
+#define RTSLICE 4
+
+static int
+rt_preempt(struct runq *rq, struct proc *p)
+{
+  return fifo_preempt(rq, p, RTSLICE);
+}
+
+static uint
+rt_nexttick(struct runq *rq, struct proc *p)
+{
+  return fifo_nexttick(rq, p, RTSLICE);
+}
+
+static int
+rt_stop(struct proc *p)
+{
+  return p->ticks_curr % RTSLICE == 0;
+}
+
+static struct schedops rt_ops = {
+  .name = "rt",
+  .init = newslice,
+  .enqueue = fifo_enqueue,
+  .dequeue = rq_remove,
+  .pick_next = rq_highest,
+  .preempt = rt_preempt,
+  .nexttick = rt_nexttick,
+  .stop = rt_stop,
+};
+
+// The batch class: one level below every normal proc, so batch
+// procs run only when the normal and real-time classes have
+// nothing to run.  They take long turns of BATCHSLICE ticks and
+// are never boosted for starvation.
+
+#define BATCHSLICE 64
+
+static int
+batch_preempt(struct runq *rq, struct proc *p)
+{
+  return fifo_preempt(rq, p, BATCHSLICE);
+}
+
+static uint
+batch_nexttick(struct runq *rq, struct proc *p)
+{
+  return fifo_nexttick(rq, p, BATCHSLICE);
+}
+
+static int
+batch_stop(struct proc *p)
+{
+  return p->ticks_curr % BATCHSLICE == 0;
+}
+
+static struct schedops batch_ops = {
+  .name = "batch",
+  .init = newslice,
+  .enqueue = fifo_enqueue,
+  .dequeue = rq_remove,
+  .pick_next = rq_highest,
+  .preempt = batch_preempt,
+  .nexttick = batch_nexttick,
+  .stop = batch_stop,
+};
+
+// The deadline class: earliest deadline first, above every other
+// class.  A proc reserves dl_budget ticks in every dl_period (see
+// setdeadline()), due by the end of the period, and the level is
+// kept sorted by that deadline.  A proc that has used its budget
+// is throttled until its next period (see throttle()); one still
+// short of its budget when its deadline passes has missed it.
+
+// Start p's next period if its deadline has passed.  A proc that
+// wanted the cpu all along (missed is non-zero) has missed its
+// deadline if it still has budget left, and every whole period
+// since; one that slept has not.
+static void
+dl_renew(struct proc *p, int missed)
+{
+  uint late;
+
+  if((int)(late = ticks - p->dl_deadline) < 0)
+    return;
+  if(missed)
+    p->dl_missed += late / p->dl_period + (p->dl_left > 0);
+  p->dl_deadline += (late / p->dl_period + 1) * p->dl_period;
+  p->dl_left = p->dl_budget;
+}
+
+static void
+dl_init(struct proc *p)
+{
+  p->dl_deadline = ticks + p->dl_period;
+  p->dl_left = p->dl_budget;
+  newslice(p);
+}
+
+// Behind every proc with the same deadline, unless p keeps
+// its turn.
+static void
+dl_enqueue(struct runq *rq, struct proc *p, int front)
+{
+  struct proc *head, *q;
+  int d;
+
+  q = 0;
+  if((head = rq->queue[QDL]) != 0){
+    q = head;
+    while((d = q->dl_deadline - p->dl_deadline) < 0 || (d == 0 && !front))
+      if((q = q->rq_next) == head){
+        q = 0;
+        break;
+      }
+  }
+  rq_insert(rq, p, q);
+}
+
+static void
+dl_charge(struct proc *p, uint n)
+{
+  p->dl_left = (uint)p->dl_left > n ? p->dl_left - n : 0;
+  dl_renew(p, 1);
+}
+
+static int
+dl_preempt(struct runq *rq, struct proc *p)
+{
+  struct proc *head = rq->queue[QDL];
+
+  if(p->dl_left == 0)
+    return 1;
+  return head && (int)(head->dl_deadline - p->dl_deadline) < 0;
+}
+
+// The tick at which p runs out of budget, or at which its
+// deadline passes and it may fall behind a queued proc.
+static uint
+dl_nexttick(struct runq *rq, struct proc *p)
+{
+  int n, m;
+
+  if(p->dl_left == 0)
+    return 1;
+  n = p->dl_left + 1;
+  if(rq->queue[QDL] != 0){
+    m = p->dl_deadline - ticks + 1;
+    if(m < 1)
+      m = 1;
+    if(m < n)
+      n = m;
+  }
+  return n;
+}
+
+static int
+dl_stop(struct proc *p)
+{
+  return 1;
+}
+
+static void
+dl_wakeup(struct runq *rq, struct proc *p)
+{
+  dl_renew(p, 0);
+}
+
+// Renew the periods of the deadline procs queued on rq whose
+// deadline has passed before they got the cpu, so that a proc
+// starved of its reservation shows its misses while it waits.
+// Called from the timer tick.  Caller must hold rq->lock.
+void
+dl_tick(struct runq *rq)
+{
+  struct proc *head, *p, *late;
+  int found;
+
+  late = 0;
+  while((head = rq->queue[QDL]) != 0){
+    // The level may hold procs lent it too (see setpi()).
+    found = 0;
+    p = head;
+    do {
+      if(p->class == SCHED_DEADLINE && (int)(ticks - p->dl_deadline) >= 0){
+        found = 1;
+        break;
+      }
+    } while((p = p->rq_next) != head);
+    if(!found)
+      break;
+    rq_remove(rq, p);
+    dl_renew(p, 1);
+    p->rq_next = late;
+    late = p;
+  }
+
+  // Back in deadline order.
+  while((p = late) != 0){
+    late = p->rq_next;
+    dl_enqueue(rq, p, 0);
+  }
+}
+
+static struct schedops dl_ops = {
+  .name = "deadline",
+  .init = dl_init,
+  .enqueue = dl_enqueue,
+  .dequeue = rq_remove,
+  .pick_next = rq_highest,
+  .charge = dl_charge,
+  .preempt = dl_preempt,
+  .nexttick = dl_nexttick,
+  .stop = dl_stop,
+  .wakeup = dl_wakeup,
+};
+
+// The ops for proc p: those of its class, or for a normal proc,
+// those of the policy in use.
+struct schedops*
+classops(struct proc *p)
+{
+  if(p->class == SCHED_RT)
+    return &rt_ops;
+  if(p->class == SCHED_BATCH)
+    return &batch_ops;
+  if(p->class == SCHED_DEADLINE)
+    return &dl_ops;
+  return schedops;
+}
+
+// Move p, which is on no run queue, to class cls (at real-time
+// priority prio, or with the reservation already in p for
+// SCHED_DEADLINE) and set it up there.  A proc entering the
+// normal class picks up at the MLFQ level it left; setsched()
+// keeps that state valid for the policy in use meanwhile.
+void
+schedclass(struct proc *p, int cls, int prio)
+{
+  int old = p->class;
+
+  p->class = cls;
+  p->rtprio = cls == SCHED_RT ? prio : 0;
+  if(cls != SCHED_NORMAL)
+    classops(p)->init(p);
+  else if(old != SCHED_NORMAL)
+    newslice(p);
+}
+
+static struct schedops *policies[] = {
+  &mlfq_ops,
+  &rr_ops,
+  &stride_ops,
+};
+
+// The policy called name, or 0.
+struct schedops*
+schedlookup(char *name)
+{
+  int i;
+
+  for(i = 0; i < NELEM(policies); i++)
+    if(strncmp(policies[i]->name, name, SCHEDNAME) == 0)
+      return policies[i];
+  return 0;
+}
+
+void
+schedinit(void)
+{
+  if((schedops = schedlookup(SCHEDPOLICY)) == 0)
+    panic("schedinit");
+}
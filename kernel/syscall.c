@@ -117,6 +117,18 @@ static int (*syscalls[])(void) = {
 [SYS_sem_post]        sys_sem_post,
 [SYS_sem_destroy]     sys_sem_destroy,
 [SYS_getfilenum]      sys_getfilenum,
+[SYS_getcpuinfo]      sys_getcpuinfo,
+[SYS_getprocs]        sys_getprocs,
+[SYS_setaffinity]     sys_setaffinity,
+[SYS_getaffinity]     sys_getaffinity,
+[SYS_setgang]         sys_setgang,
+[SYS_setsched]        sys_setsched,
+[SYS_setclass]        sys_setclass,
+[SYS_setdeadline]     sys_setdeadline,
+[SYS_setgroup]        sys_setgroup,
+[SYS_setquota]        sys_setquota,
+[SYS_setmlfq]         sys_setmlfq,
+[SYS_getmeminfo]      sys_getmeminfo,
 };
 
 // Called on a syscall trap. Checks that the syscall number (passed via eax)
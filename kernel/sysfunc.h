@@ -35,5 +35,17 @@ int sys_sem_wait(void);
 int sys_sem_post(void);
 int sys_sem_destroy(void);
 int sys_getfilenum(void);
+int sys_getcpuinfo(void);
+int sys_getprocs(void);
+int sys_setaffinity(void);
+int sys_getaffinity(void);
+int sys_setgang(void);
+int sys_setsched(void);
+int sys_setclass(void);
+int sys_setdeadline(void);
+int sys_setgroup(void);
+int sys_setquota(void);
+int sys_setmlfq(void);
+int sys_getmeminfo(void);
 
 #endif // _SYSFUNC_H_
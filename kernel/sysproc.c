@@ -65,6 +65,7 @@ sys_sleep(void)
   
   if(argint(0, &n) < 0)
     return -1;
+  tickupdate();
   acquire(&tickslock);
   ticks0 = ticks;
   while(ticks - ticks0 < n){
@@ -72,6 +73,7 @@ sys_sleep(void)
       release(&tickslock);
       return -1;
     }
+    tickalarm(ticks0 + n);
     sleep(&ticks, &tickslock);
   }
   release(&tickslock);
@@ -85,6 +87,7 @@ sys_uptime(void)
 {
   uint xticks;
   
+  tickupdate();
   acquire(&tickslock);
   xticks = ticks;
   release(&tickslock);
@@ -216,6 +219,136 @@ int sys_sem_destroy(void)
   return sem_destroy(sem_id);
 }
 
+int
+sys_getcpuinfo(void)
+{
+  struct cpustat *cs;
+  if(argptr(0, (void*)&cs, sizeof(*cs)) < 0)
+    return -1;
+  return getcpuinfo(cs);
+}
+
+int
+sys_getmeminfo(void)
+{
+  struct memstat *ms;
+  if(argptr(0, (void*)&ms, sizeof(*ms)) < 0)
+    return -1;
+  return getmeminfo(ms);
+}
+
+int
+sys_getprocs(void)
+{
+  int pid, n;
+  struct procinfo *info;
+
+  if(argint(0, &pid) < 0 || argint(2, &n) < 0 || n < 0)
+    return -1;
+  // n*sizeof(*info) must not wrap around to a size argptr() allows.
+  if(n > proc->sz / sizeof(*info))
+    return -1;
+  if(argptr(1, (void*)&info, n*sizeof(*info)) < 0)
+    return -1;
+  return getprocs(pid, info, n);
+}
+
+int
+sys_setaffinity(void)
+{
+  int pid, mask;
+
+  if(argint(0, &pid) < 0 || argint(1, &mask) < 0)
+    return -1;
+  return setaffinity(pid, mask);
+}
+
+int
+sys_getaffinity(void)
+{
+  int pid;
+
+  if(argint(0, &pid) < 0)
+    return -1;
+  return getaffinity(pid);
+}
+
+int
+sys_setgang(void)
+{
+  int on;
+
+  if(argint(0, &on) < 0)
+    return -1;
+  return setgang(on);
+}
+
+int
+sys_setsched(void)
+{
+  char *name;
+
+  if(argstr(0, &name) < 0)
+    return -1;
+  return setsched(name);
+}
+
+int
+sys_setclass(void)
+{
+  int pid, cls, prio;
+
+  if(argint(0, &pid) < 0 || argint(1, &cls) < 0 || argint(2, &prio) < 0)
+    return -1;
+  return setclass(pid, cls, prio);
+}
+
+int
+sys_setdeadline(void)
+{
+  int pid, budget, period;
+
+  if(argint(0, &pid) < 0 || argint(1, &budget) < 0 || argint(2, &period) < 0)
+    return -1;
+  return setdeadline(pid, budget, period);
+}
+
+int
+sys_setgroup(void)
+{
+  int pid, grp;
+
+  if(argint(0, &pid) < 0 || argint(1, &grp) < 0)
+    return -1;
+  return setgroup(pid, grp);
+}
+
+int
+sys_setquota(void)
+{
+  int grp, quota, period;
+
+  if(argint(0, &grp) < 0 || argint(1, &quota) < 0 || argint(2, &period) < 0)
+    return -1;
+  return setquota(grp, quota, period);
+}
+
+// Either argument may be 0 (see setmlfq()).
+int
+sys_setmlfq(void)
+{
+  int old, new;
+  char *po = 0, *pn = 0;
+
+  if(argint(0, &old) < 0 || argint(1, &new) < 0)
+    return -1;
+  if(old != 0 && argptr(0, &po, sizeof(struct mlfqparam)) < 0)
+    return -1;
+  if(new != 0 && argptr(1, &pn, sizeof(struct mlfqparam)) < 0)
+    return -1;
+  return setmlfq((struct mlfqparam*)po, (struct mlfqparam*)pn);
+}
+
 int
 sys_getfilenum(void)
 {
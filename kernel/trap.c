@@ -13,6 +13,13 @@ extern uint vectors[];  // in vectors.S: array of 256 entry pointers
 struct spinlock tickslock;
 uint ticks;
 
+// With dynamic ticks no cpu takes an interrupt on every tick,
+// so ticks is brought up to date from the TSC instead, by
+// whichever cpu next looks at it.
+static uint64 ticktsc;  // TSC at the tick boundary ticks was last advanced to
+static uint sleepwake;  // Earliest tick a sys_sleep() caller waits for
+static int sleepers;    // Is sleepwake valid?
+
 void
 tvinit(void)
 {
@@ -23,6 +30,73 @@ tvinit(void)
   SETGATE(idt[T_SYSCALL], 1, SEG_KCODE<<3, vectors[T_SYSCALL], DPL_USER);
   
   initlock(&tickslock, "time");
+  ticktsc = rdtsc();
+}
+
+// Advance ticks to the current time and wake sys_sleep()
+// callers whose deadline has passed.  The boot cpu arms its
+// timer for the earliest deadline (see tickalarmin()).
+void
+tickupdate(void)
+{
+  uint64 delta;
+  uint n;
+
+  if(!dyntick)
+    return;
+  acquire(&tickslock);
+  delta = rdtsc() - ticktsc;
+  if((uint)(delta >> 32) >= tsctick)
+    panic("tickupdate");
+  n = divl(delta, tsctick);
+  if(n > 0){
+    ticks += n;
+    ticktsc += (uint64)n * tsctick;
+    if(sleepers && (int)(ticks - sleepwake) >= 0){
+      sleepers = 0;
+      wakeup(&ticks);
+    }
+  }
+  release(&tickslock);
+}
+
+// Ask for a wakeup(&ticks) once ticks reaches when.
+// Caller must hold tickslock.
+void
+tickalarm(uint when)
+{
+  int bcpu;
+
+  if(sleepers && (int)(when - sleepwake) >= 0)
+    return;
+  sleepers = 1;
+  sleepwake = when;
+
+  // The boot cpu may be halted or running with its timer
+  // armed past the new deadline.
+  pushcli();
+  bcpu = mpbcpu();
+  if(dyntick && cpu != &cpus[bcpu])
+    lapicipi(cpus[bcpu].id, T_IRQ0 + IRQ_WAKEUP);
+  popcli();
+}
+
+// Ticks until the earliest sys_sleep() deadline,
+// or 0 if nobody is waiting.  Reads the TSC rather than
+// ticks, which may not have been advanced for a while.
+uint
+tickalarmin(void)
+{
+  uint64 delta;
+  int n;
+
+  if(!sleepers)
+    return 0;
+  delta = rdtsc() - ticktsc;
+  if((uint)(delta >> 32) >= tsctick)
+    return 1;
+  n = sleepwake - (ticks + divl(delta, tsctick));
+  return n < 1 ? 1 : n;
 }
 
 void
@@ -34,6 +108,8 @@ idtinit(void)
 void
 trap(struct trapframe *tf)
 {
+  int preempt = 0;
+
   if(tf->trapno == T_SYSCALL){
     if(proc->killed)
       exit();
@@ -46,18 +122,30 @@ trap(struct trapframe *tf)
 
   switch(tf->trapno){
   case T_IRQ0 + IRQ_TIMER:
-    if(cpu->id == 0){
+    if(dyntick)
+      tickupdate();
+    else if(cpu->id == 0){
       acquire(&tickslock);
       ticks++;
       wakeup(&ticks);
       release(&tickslock);
     }
+    preempt = schedtick();
     lapiceoi();
     break;
   case T_IRQ0 + IRQ_IDE:
     ideintr();
     lapiceoi();
     break;
+  case T_IRQ0 + IRQ_WAKEUP:
+    // Another cpu queued work for us while we were idle;
+    // scheduler() will find it once we return.  If we were
+    // running with the timer armed far ahead, or are the
+    // cpu keeping time for a new sleep() deadline, re-arm it.
+    if(dyntick)
+      preempt = schedtick();
+    lapiceoi();
+    break;
   case T_IRQ0 + IRQ_IDE+1:
     // Bochs generates spurious IDE1 interrupts.
     break;
@@ -97,9 +185,12 @@ trap(struct trapframe *tf)
   if(proc && proc->killed && (tf->cs&3) == DPL_USER)
     exit();
 
-  // Force process to give up CPU on clock tick.
+  // Force process to give up CPU on clock tick, if the
+  // scheduler wants it back (see schedtick()).  A deadline
+  // proc out of budget waits for its next period instead.
   // If interrupts were on while locks held, would need to check nlock.
-  if(proc && proc->state == RUNNING && tf->trapno == T_IRQ0+IRQ_TIMER)
+  if(proc && proc->state == RUNNING && preempt &&
+     ((tf->cs&3) != DPL_USER || !throttle()))
     yield();
 
   // Check if the process has been killed since we yielded
@@ -1,9 +1,10 @@
 
 # dependency files
-TOOLS_DEPS := tools/mkfs.d
+TOOLS_DEPS := tools/mkfs.d tools/mlfqsim.d
 
 # all generated files
-TOOLS_CLEAN := tools/mkfs tools/mkfs.o $(TOOLS_DEPS)
+TOOLS_CLEAN := tools/mkfs tools/mkfs.o tools/mlfqsim tools/mlfqsim.o \
+	tools/sched.o $(TOOLS_DEPS)
 
 # flags
 TOOLS_CPPFLAGS := -iquote include
@@ -12,6 +13,18 @@ TOOLS_CPPFLAGS := -iquote include
 tools/mkfs: tools/mkfs.o
 	$(CC) $(LDFLAGS) $< -o $@
 
+# mlfqsim: the scheduling policies of kernel/sched.c on a simulated clock
+tools/mlfqsim: tools/mlfqsim.o tools/sched.o
+	$(CC) $(LDFLAGS) $^ -o $@
+
+# mlfqsim needs struct proc from kernel/proc.h
+tools/mlfqsim.o tools/mlfqsim.d tools/sched.o: TOOLS_CPPFLAGS += -iquote kernel
+
+# kernel/sched.c built for the host; kernel/defs.h clashes with the
+# host's builtins (memset, exit) unless they are turned off
+tools/sched.o: kernel/sched.c
+	$(CC) -c $(CPPFLAGS) $(TOOLS_CPPFLAGS) $(CFLAGS) -fno-builtin -o $@ $<
+
 # build object files from c files
 tools/%.o: tools/%.c
 	$(CC) -c $(CPPFLAGS) $(TOOLS_CPPFLAGS) $(CFLAGS) $(TOOLS_CLFAGS) -o $@ $<
@@ -0,0 +1,495 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include "types.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "pstat.h"
+
+// Host-side simulator for the scheduling policies of kernel/sched.c.
+//
+// kernel/sched.c is compiled for the host unchanged (see
+// tools/makefile.mk) and driven here the way kernel/proc.c drives
+// it on one cpu without dynamic ticks: at every tick the policy
+// ages its queues, the running proc gives up the cpu and is
+// requeued (or sleeps, or exits), and the head of the highest
+// non-empty level is dispatched.  Jobs come from a trace, and
+// the simulator reports throughput, turnaround and wait times,
+// so policy parameters can be swept in seconds instead of
+// booting xv6 for each setting.
+//
+// To compile from the top directory:
+//  $ make tools/mlfqsim
+// Usage:
+//  $ tools/mlfqsim [-p policy] [-l levels] [-s slices] [-r quanta]
+//                  [-a aging] [-i top,gap] [-g n[,seed]] [-w out] [-v] [trace]
+//   -p  policy from kernel/sched.c: mlfq (default), rr or stride
+//   -l  MLFQ levels in use, 1 to NLAYER
+//   -s  MLFQ time slice of each level, level 0 first: e.g. 64,32,16,8
+//   -r  MLFQ round-robin quantum of each level, level 0 first
+//   -a  MLFQ aging threshold, in time slices of a level
+//   -i  highest level and minimum gap in ticks of I/O wakeup boosts
+//   -g  generate n synthetic jobs (from seed) instead of reading a trace
+//   -w  write the jobs simulated to out as a trace
+//   -v  report every job
+// e.g.: $ tools/mlfqsim -g 50 -s 64,32,16,4 -a 20
+//
+// A trace has one job per line, '#' starting a comment:
+//   arrival cpu [io cpu]...
+// where arrival is the tick the job is forked at, each cpu is a
+// burst of ticks it runs for, and each io is ticks it then sleeps
+// for in sleepio(), as if waiting for the disk, console or a pipe.
+
+// From kernel/defs.h, which declares kernel functions that clash
+// with the host's, such as exit().
+extern struct schedops *schedops;
+extern uint ticks;
+struct schedops* schedlookup(char*);
+void mlfq_get(struct mlfqparam*);
+int mlfq_check(struct mlfqparam*);
+void mlfq_set(struct mlfqparam*);
+
+#define MAXTICK 100000000  // give up on a trace after this many ticks
+
+struct job {
+  struct proc p;             // What the policy sees
+  int arrival;               // Tick it is forked at
+  int *burst;                // cpu, io, cpu, ... ticks
+  int nburst;
+  int cur;                   // Burst it is in
+  int left;                  // Ticks left in it
+  int wake;                  // Tick its I/O completes, while sleeping
+  int ready;                 // Tick it last became runnable
+  int woken;                 // Became runnable by waking from I/O
+  int finish;                // Tick it exited, or -1
+  int ran;                   // Ticks it has run
+  int waited;                // Ticks it has waited runnable
+};
+
+struct job *jobs;
+int njob;
+
+// Wait times of every dispatch, and of those after an I/O wakeup.
+struct samples {
+  int *v;
+  int n, max;
+} waits, responses;
+
+uint ticks;
+
+void
+panic(char *s)
+{
+  fprintf(stderr, "panic: %s\n", s);
+  exit(1);
+}
+
+static void
+record(struct samples *s, int v)
+{
+  if(s->n == s->max){
+    s->max = s->max ? 2 * s->max : 1024;
+    if((s->v = realloc(s->v, s->max * sizeof(int))) == 0)
+      panic("out of memory");
+  }
+  s->v[s->n++] = v;
+}
+
+static int
+intcmp(const void *a, const void *b)
+{
+  return *(const int*)a - *(const int*)b;
+}
+
+// Print the mean, median, 99th percentile and maximum of s.
+static void
+report(char *name, struct samples *s)
+{
+  double sum = 0;
+  int i;
+
+  if(s->n == 0){
+    printf("%-11s none\n", name);
+    return;
+  }
+  qsort(s->v, s->n, sizeof(int), intcmp);
+  for(i = 0; i < s->n; i++)
+    sum += s->v[i];
+  printf("%-11s mean %.1f  p50 %d  p99 %d  max %d  (%d samples)\n", name,
+         sum / s->n, s->v[s->n / 2], s->v[(s->n - 1) * 99 / 100],
+         s->v[s->n - 1], s->n);
+}
+
+static struct job*
+addjob(int arrival, int *burst, int nburst)
+{
+  struct job *j;
+
+  if((jobs = realloc(jobs, (njob + 1) * sizeof(*jobs))) == 0)
+    panic("out of memory");
+  j = &jobs[njob++];
+  memset(j, 0, sizeof(*j));
+  j->arrival = arrival;
+  j->nburst = nburst;
+  if((j->burst = malloc(nburst * sizeof(int))) == 0)
+    panic("out of memory");
+  memcpy(j->burst, burst, nburst * sizeof(int));
+  return j;
+}
+
+// Read a trace from f.  Returns -1 on a malformed line.
+static int
+readtrace(FILE *f)
+{
+  char line[4096], *s, *e;
+  int v[1024], n, lineno = 0;
+
+  while(fgets(line, sizeof(line), f)){
+    lineno++;
+    if((s = strchr(line, '#')) != 0)
+      *s = 0;
+    n = 0;
+    for(s = line; n < 1024; s = e){
+      v[n] = strtol(s, &e, 10);
+      if(e == s)
+        break;
+      if(v[n] < 0 || (n > 0 && v[n] == 0))
+        break;
+      n++;
+    }
+    while(*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r')
+      s++;
+    if(n == 0 && *s == 0)
+      continue;
+    if(n < 2 || *s != 0 || n % 2 != 0){
+      fprintf(stderr, "trace line %d: expected arrival cpu [io cpu]...\n",
+              lineno);
+      return -1;
+    }
+    addjob(v[0], v + 1, n - 1);
+  }
+  return 0;
+}
+
+static uint rnd;
+
+// Xorshift, so a seed gives the same jobs on every host.
+static int
+between(int lo, int hi)
+{
+  rnd ^= rnd << 13;
+  rnd ^= rnd >> 17;
+  rnd ^= rnd << 5;
+  return lo + rnd % (hi - lo + 1);
+}
+
+// Make up n jobs arriving over the first few hundred ticks: one
+// in four CPU-bound, the rest interactive, running a tick or
+// three between I/O waits.
+static void
+synthetic(int n, uint seed)
+{
+  int v[81], i, k, m;
+
+  rnd = seed ? seed : 1;
+  for(i = 0; i < n; i++){
+    if(between(0, 3) == 0){
+      v[0] = between(100, 1000);
+      m = 1;
+    } else {
+      m = 2 * between(5, 40) - 1;
+      for(k = 0; k < m; k++)
+        v[k] = k % 2 ? between(5, 30) : between(1, 3);
+    }
+    addjob(between(0, 500), v, m);
+  }
+}
+
+static void
+writetrace(FILE *f)
+{
+  int i, k;
+
+  fprintf(f, "# arrival cpu [io cpu]...\n");
+  for(i = 0; i < njob; i++){
+    fprintf(f, "%d", jobs[i].arrival);
+    for(k = 0; k < jobs[i].nburst; k++)
+      fprintf(f, " %d", jobs[i].burst[k]);
+    fprintf(f, "\n");
+  }
+}
+
+// Parse a comma-separated list of up to n positive numbers into v.
+// Returns how many there were, or -1.
+static int
+parselist(char *s, int *v, int n)
+{
+  char *e;
+  int i;
+
+  for(i = 0; i < n; i++){
+    v[i] = strtol(s, &e, 10);
+    if(e == s || v[i] < 0)
+      return -1;
+    if(*e == 0)
+      return i + 1;
+    if(*e != ',')
+      return -1;
+    s = e + 1;
+  }
+  return -1;
+}
+
+// What proc.c's account() does: charge p for n ticks.
+static void
+account(struct proc *p, uint n)
+{
+  p->ticks_curr += n;
+  p->ticks[p->level] += n;
+  if(schedops->charge)
+    schedops->charge(p, n);
+}
+
+static struct job*
+jobof(struct proc *p)
+{
+  return (struct job*)((char*)p - offsetof(struct job, p));
+}
+
+// What proc.c's ready() does for a new or woken proc, on the one cpu.
+static void
+ready(struct runq *rq, struct job *j, int woken)
+{
+  struct proc *p = &j->p;
+
+  if(p->state == SLEEPING && schedops->wakeup)
+    schedops->wakeup(rq, p);
+  p->state = RUNNABLE;
+  schedops->enqueue(rq, p, 0);
+  j->ready = ticks;
+  j->woken = woken;
+}
+
+// Run every job to completion.  Returns the tick the last exited.
+static int
+simulate(int verbose, int *busy)
+{
+  struct runq rq;
+  struct proc *p;
+  struct job *j, *run;
+  int i, left, tail;
+
+  memset(&rq, 0, sizeof(rq));
+  run = 0;
+  left = njob;
+  *busy = 0;
+  for(i = 0; i < njob; i++){
+    jobs[i].finish = -1;
+    jobs[i].p.pid = i + 1;
+  }
+
+  for(ticks = 0; left > 0; ticks++){
+    if(ticks >= MAXTICK)
+      panic("trace does not finish");
+
+    // New procs are forked, and I/O completes.
+    for(i = 0; i < njob; i++){
+      j = &jobs[i];
+      if(j->arrival == ticks){
+        j->p.state = EMBRYO;
+        schedops->init(&j->p);
+        j->left = j->burst[0];
+        ready(&rq, j, 0);
+      } else if(j->p.state == SLEEPING && j->wake == ticks){
+        j->cur++;
+        j->left = j->burst[j->cur];
+        ready(&rq, j, 1);
+      }
+    }
+
+    if(schedops->tick)
+      schedops->tick(&rq);
+
+    // The running proc has run a tick.  Without dynamic ticks
+    // trap() has it yield() at every one; it may also be done
+    // with its burst, and sleep or exit.
+    if(run){
+      p = &run->p;
+      run->ran++;
+      if(--run->left > 0){
+        tail = schedops->stop(p);
+        p->state = RUNNABLE;
+        schedops->enqueue(&rq, p, !tail);
+        run->ready = ticks;
+        run->woken = 0;
+      } else if(run->cur + 1 < run->nburst){
+        schedops->stop(p);
+        p->iowait = 1;
+        p->state = SLEEPING;
+        run->cur++;
+        run->wake = ticks + run->burst[run->cur];
+      } else {
+        p->state = ZOMBIE;
+        run->finish = ticks;
+        left--;
+      }
+      run = 0;
+    }
+
+    // Dispatch.
+    if((p = schedops->pick_next(&rq)) != 0){
+      rq.clock++;
+      schedops->dequeue(&rq, p);
+      p->state = RUNNING;
+      p->wait_ticks_curr = 0;
+      account(p, 1);
+      run = jobof(p);
+      run->waited += ticks - run->ready;
+      record(&waits, ticks - run->ready);
+      if(run->woken)
+        record(&responses, ticks - run->ready);
+      run->woken = 0;
+      (*busy)++;
+    }
+  }
+
+  if(verbose){
+    printf("%5s %8s %8s %8s %8s %8s\n",
+           "job", "arrival", "ran", "waited", "finish", "turnaround");
+    for(i = 0; i < njob; i++){
+      j = &jobs[i];
+      printf("%5d %8d %8d %8d %8d %8d\n", i + 1, j->arrival, j->ran,
+             j->waited, j->finish, j->finish - j->arrival);
+    }
+  }
+  return ticks;
+}
+
+static void
+usage(void)
+{
+  fprintf(stderr, "usage: mlfqsim [-p policy] [-l levels] [-s slices] "
+          "[-r quanta] [-a aging] [-i top,gap] [-g n[,seed]] [-w out] "
+          "[-v] [trace]\n");
+  exit(2);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct mlfqparam mp;
+  struct samples turnaround;
+  char *policy = "mlfq", *out = 0;
+  int c, i, n, end, busy, ngen = 0, verbose = 0, v[2];
+  uint seed = 1;
+  FILE *f;
+
+  mlfq_get(&mp);
+  while((c = getopt(argc, argv, "p:l:s:r:a:i:g:w:v")) != -1){
+    switch(c){
+    case 'p':
+      policy = optarg;
+      break;
+    case 'l':
+      mp.nlevel = atoi(optarg);
+      break;
+    case 's':
+      if(parselist(optarg, mp.slice, NLAYER) < 0)
+        usage();
+      break;
+    case 'r':
+      if(parselist(optarg, mp.rr, NLAYER) < 0)
+        usage();
+      break;
+    case 'a':
+      mp.aging = atoi(optarg);
+      break;
+    case 'i':
+      if(parselist(optarg, v, 2) != 2)
+        usage();
+      mp.ioboost_top = v[0];
+      mp.ioboost_gap = v[1];
+      break;
+    case 'g':
+      if((n = parselist(optarg, v, 2)) < 1)
+        usage();
+      ngen = v[0];
+      if(n == 2)
+        seed = v[1];
+      break;
+    case 'w':
+      out = optarg;
+      break;
+    case 'v':
+      verbose = 1;
+      break;
+    default:
+      usage();
+    }
+  }
+  if(mp.ioboost_top >= mp.nlevel && mp.nlevel > 0)
+    mp.ioboost_top = mp.nlevel - 1;
+  if(mlfq_check(&mp) < 0){
+    fprintf(stderr, "mlfqsim: bad MLFQ parameters\n");
+    exit(2);
+  }
+  mlfq_set(&mp);
+  if((schedops = schedlookup(policy)) == 0){
+    fprintf(stderr, "mlfqsim: no policy %s\n", policy);
+    exit(2);
+  }
+
+  if(ngen > 0)
+    synthetic(ngen, seed);
+  else if(optind < argc && strcmp(argv[optind], "-") != 0){
+    if((f = fopen(argv[optind], "r")) == 0){
+      perror(argv[optind]);
+      exit(1);
+    }
+    if(readtrace(f) < 0)
+      exit(1);
+    fclose(f);
+  } else if(readtrace(stdin) < 0)
+    exit(1);
+  if(njob == 0){
+    fprintf(stderr, "mlfqsim: no jobs\n");
+    exit(1);
+  }
+  if(out){
+    if((f = fopen(out, "w")) == 0){
+      perror(out);
+      exit(1);
+    }
+    writetrace(f);
+    fclose(f);
+  }
+
+  printf("policy %s", policy);
+  if(strcmp(policy, "mlfq") == 0){
+    printf(", %d levels, slices", mp.nlevel);
+    for(i = 0; i < mp.nlevel; i++)
+      printf("%c%d", i == 0 ? ' ' : ',', mp.slice[i]);
+    printf(", quanta");
+    for(i = 0; i < mp.nlevel; i++)
+      printf("%c%d", i == 0 ? ' ' : ',', mp.rr[i]);
+    printf(", aging %dx, I/O boost to %d every %d", mp.aging,
+           mp.ioboost_top, mp.ioboost_gap);
+  }
+  printf("\n");
+
+  end = simulate(verbose, &busy);
+
+  memset(&turnaround, 0, sizeof(turnaround));
+  for(i = 0; i < njob; i++)
+    record(&turnaround, jobs[i].finish - jobs[i].arrival);
+  printf("%d jobs in %d ticks, cpu busy %.1f%%, %.2f jobs per 1000 ticks\n",
+         njob, end, 100.0 * busy / end, 1000.0 * njob / end);
+  report("turnaround", &turnaround);
+  report("wait", &waits);
+  report("response", &responses);
+  return 0;
+}
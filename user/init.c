@@ -4,9 +4,32 @@
 #include "stat.h"
 #include "user.h"
 #include "fcntl.h"
+#include "param.h"
 
 char *argv[] = { "sh", 0 };
 
+// Switch to the scheduling policy named in /sched, if there is one.
+void
+schedpolicy(void)
+{
+  char name[SCHEDNAME];
+  int fd, n;
+
+  if((fd = open("/sched", O_RDONLY)) < 0)
+    return;
+  n = read(fd, name, sizeof(name)-1);
+  close(fd);
+  if(n <= 0)
+    return;
+  name[n] = 0;
+  if(name[n-1] == '\n')
+    name[n-1] = 0;
+  if(setsched(name) < 0)
+    printf(1, "init: no scheduling policy %s\n", name);
+  else
+    printf(1, "init: scheduling policy %s\n", name);
+}
+
 int
 main(void)
 {
@@ -19,6 +42,7 @@ main(void)
   dup(0);  // stdout
   dup(0);  // stderr
 
+  schedpolicy();
   for(;;){
     printf(1, "init: starting sh\n");
     pid = fork();
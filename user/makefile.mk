@@ -22,6 +22,19 @@ USER_PROGS := \
 	test-ticks\
 	test-sem\
 	test-filenum\
+	test-idle\
+	test-procs\
+	test-migrate\
+	test-affinity\
+	test-gang\
+	test-sched\
+	test-class\
+	test-deadline\
+	test-group\
+	test-pi\
+	test-ioboost\
+	test-mlfqparam\
+	test-kalloc\
     grave
 
 USER_PROGS := $(addprefix user/, $(USER_PROGS))
@@ -0,0 +1,62 @@
+/* Written by Roxin Liu */
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "pstat.h"
+
+// Pin this process to each cpu in turn and check with getprocs()
+// that it runs there, then check that a child inherits the mask.
+int main(int argc, char *argv[])
+{
+	struct cpustat cs;
+	struct procinfo info;
+	int i, pid, self, mask, failed = 0;
+
+	getcpuinfo(&cs);
+	self = getpid();
+
+	for (i = 0; i < cs.ncpu; i++) {
+		if (setaffinity(self, 1 << i) < 0) {
+			printf(1, "setaffinity(%d, %x) failed\n", self, 1 << i);
+			failed = 1;
+			continue;
+		}
+		if (getprocs(self, &info, 1) != 1 || info.pid != self ||
+		    info.cpu != i) {
+			printf(1, "pinned to cpu%d but running on cpu%d\n",
+			       i, info.cpu);
+			failed = 1;
+		}
+	}
+
+	mask = (1 << cs.ncpu) - 1;
+	setaffinity(self, mask);
+	if (getaffinity(self) != mask) {
+		printf(1, "getaffinity(%d) = %x, expected %x\n",
+		       self, getaffinity(self), mask);
+		failed = 1;
+	}
+
+	setaffinity(self, 1);
+	pid = fork();
+	if (pid == 0) {
+		exit();
+	}
+	if (getaffinity(pid) != 1) {
+		printf(1, "child mask %x, expected 1\n", getaffinity(pid));
+		failed = 1;
+	}
+	wait();
+	setaffinity(self, mask);
+
+	if (failed)
+		printf(1, "TEST FAILED\n");
+	else
+		printf(1, "TEST PASSED\n");
+
+	printf(1, "\nResults below should be -1: \n");
+	printf(1, "setaffinity(%d, 0) = %d\n", self, setaffinity(self, 0));
+	printf(1, "getaffinity(-1) = %d\n", getaffinity(-1));
+	exit();
+}
@@ -0,0 +1,108 @@
+/* Written by Roxin Liu */
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "pstat.h"
+
+// Wait for the go, move to class cls, spin for ms ticks and
+// report how many loops were done.
+void
+hog(int go, int fd, int cls, int ms)
+{
+	int end, loops;
+	volatile int x;
+	char c;
+
+	read(go, &c, 1);
+	setclass(getpid(), cls, 0);
+	loops = 0;
+	end = uptime() + ms;
+	while (uptime() < end) {
+		for (x = 0; x < 10000; x++)
+			;
+		loops++;
+	}
+	write(fd, &loops, sizeof(loops));
+	exit();
+}
+
+// Run a hog of class high and one of class low on cpu 0 for ms
+// ticks.  The low one should hardly run at all.  Returns 0 if it
+// did not.
+int
+run(char *name, int high, int low, int ms)
+{
+	struct cpustat cs;
+	int go[2], hi[2], lo[2], self, loops[2];
+
+	getcpuinfo(&cs);
+	self = getpid();
+	pipe(go);
+	pipe(hi);
+	pipe(lo);
+
+	// Children inherit the mask; the hogs are the only procs on
+	// cpu 0 once this one moves off it again.  They start together
+	// so that neither can run alone before the other is forked.
+	setaffinity(self, 1);
+	if (fork() == 0)
+		hog(go[0], hi[1], high, ms);
+	if (fork() == 0)
+		hog(go[0], lo[1], low, ms);
+	setaffinity(self, (1 << cs.ncpu) - 1);
+	write(go[1], "go", 2);
+	close(go[0]);
+	close(go[1]);
+	close(hi[1]);
+	close(lo[1]);
+
+	wait();
+	wait();
+	read(hi[0], &loops[0], sizeof(loops[0]));
+	read(lo[0], &loops[1], sizeof(loops[1]));
+	close(hi[0]);
+	close(lo[0]);
+
+	printf(1, "%s: %d loops, shared cpu with %d loops\n",
+	       name, loops[0], loops[1]);
+	return loops[1] * 4 > loops[0];
+}
+
+int main(int argc, char *argv[])
+{
+	struct procinfo info;
+	int pid, self, failed = 0, ms = 100;
+
+	if (argc > 1)
+		ms = atoi(argv[1]);
+
+	failed |= run("rt vs normal", SCHED_RT, SCHED_NORMAL, ms);
+	failed |= run("normal vs batch", SCHED_NORMAL, SCHED_BATCH, ms);
+
+	// The class is inherited across fork().
+	self = getpid();
+	setclass(self, SCHED_BATCH, 0);
+	if ((pid = fork()) == 0) {
+		sleep(10);
+		exit();
+	}
+	if (getprocs(pid, &info, 1) != 1 || info.pid != pid ||
+	    info.class != SCHED_BATCH) {
+		printf(1, "child %d did not inherit SCHED_BATCH\n", pid);
+		failed = 1;
+	}
+	wait();
+	setclass(self, SCHED_NORMAL, 0);
+
+	printf(1, "\nResults below should be -1: \n");
+	printf(1, "setclass(%d, 3, 0) = %d\n", self, setclass(self, 3, 0));
+	printf(1, "setclass(%d, SCHED_RT, %d) = %d\n", self, NRTPRIO,
+	       setclass(self, SCHED_RT, NRTPRIO));
+
+	if (failed)
+		printf(1, "TEST FAILED\n");
+	else
+		printf(1, "TEST PASSED\n");
+	exit();
+}
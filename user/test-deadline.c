@@ -0,0 +1,166 @@
+/* Written by Roxin Liu */
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "pstat.h"
+
+#define BUDGET 2
+#define PERIOD 10
+#define NCHILD 64
+
+// Spin for ms ticks, under a reservation of BUDGET ticks every
+// PERIOD if reserve is set, and report the ticks run and the
+// deadlines missed.
+void
+hog(int go, int fd, int reserve, int ms)
+{
+	struct procinfo info;
+	int i, end, res[2];
+	volatile int x;
+	char c;
+
+	read(go, &c, 1);
+	if (reserve && setdeadline(getpid(), BUDGET, PERIOD) < 0) {
+		printf(1, "setdeadline(%d, %d, %d) failed\n",
+		       getpid(), BUDGET, PERIOD);
+		res[0] = res[1] = -1;
+		write(fd, res, sizeof(res));
+		exit();
+	}
+	end = uptime() + ms;
+	while (uptime() < end)
+		for (x = 0; x < 10000; x++)
+			;
+	getprocs(getpid(), &info, 1);
+	res[0] = 0;
+	for (i = 0; i < 4; i++)
+		res[0] += info.ticks[i];
+	res[1] = info.missed;
+	write(fd, res, sizeof(res));
+	exit();
+}
+
+// Run a reserved hog next to a normal one on cpu 0 for ms ticks.
+// The reserved one should get about BUDGET ticks in every PERIOD
+// and miss no deadline.  Returns 0 if it did.
+int
+enforce(int ms)
+{
+	struct cpustat cs;
+	int go[2], dl[2], nr[2], self, res[2], other[2];
+
+	getcpuinfo(&cs);
+	self = getpid();
+	pipe(go);
+	pipe(dl);
+	pipe(nr);
+
+	setaffinity(self, 1);
+	if (fork() == 0)
+		hog(go[0], dl[1], 1, ms);
+	if (fork() == 0)
+		hog(go[0], nr[1], 0, ms);
+	setaffinity(self, (1 << cs.ncpu) - 1);
+	write(go[1], "go", 2);
+	close(go[0]);
+	close(go[1]);
+	close(dl[1]);
+	close(nr[1]);
+
+	wait();
+	wait();
+	read(dl[0], res, sizeof(res));
+	read(nr[0], other, sizeof(other));
+	close(dl[0]);
+	close(nr[0]);
+
+	printf(1, "reserved %d/%d: ran %d ticks of %d, missed %d; "
+	       "normal ran %d ticks\n", BUDGET, PERIOD, res[0], ms, res[1],
+	       other[0]);
+	return res[0] < ms * BUDGET / PERIOD / 2 ||
+	       res[0] > ms * BUDGET / PERIOD + 2 * BUDGET || res[1] != 0;
+}
+
+// Reserve half a cpu for sleeping children until admission
+// control refuses, and check that it stops at DLLIMIT per mille
+// of each cpu (one such reservation fits on a cpu) and that
+// exiting procs give their share back.  Returns 0 if it did.
+int
+admit(void)
+{
+	struct cpustat cs;
+	int pids[NCHILD], i, n, admitted, want, failed = 0;
+
+	getcpuinfo(&cs);
+	want = DLLIMIT / 500 * cs.ncpu;
+	admitted = 0;
+	for (n = 0; n < NCHILD; ) {
+		if ((pids[n++] = fork()) == 0) {
+			sleep(1000);
+			exit();
+		}
+		if (setdeadline(pids[n-1], 5, 10) < 0)
+			break;
+		admitted++;
+	}
+	printf(1, "admitted %d procs at 5/10 on %d cpus\n", admitted,
+	       cs.ncpu);
+	if (admitted != want && want < NCHILD) {
+		printf(1, "expected %d\n", want);
+		failed = 1;
+	}
+	for (i = 0; i < n; i++)
+		kill(pids[i]);
+	for (i = 0; i < n; i++)
+		wait();
+
+	// Their reservations are free again.
+	if ((pids[0] = fork()) == 0) {
+		sleep(1000);
+		exit();
+	}
+	if (setdeadline(pids[0], 5, 10) < 0) {
+		printf(1, "reservations were not given back\n");
+		failed = 1;
+	}
+
+	// A proc held to cpu 0 only fits where cpu 0 has room.
+	if ((pids[1] = fork()) == 0) {
+		sleep(1000);
+		exit();
+	}
+	setaffinity(pids[1], 1);
+	if (setdeadline(pids[1], 5, 10) == 0 && cs.ncpu == 1) {
+		printf(1, "cpu 0 was overcommitted\n");
+		failed = 1;
+	}
+	for (i = 0; i < 2; i++)
+		kill(pids[i]);
+	for (i = 0; i < 2; i++)
+		wait();
+	return failed;
+}
+
+int main(int argc, char *argv[])
+{
+	int failed = 0, ms = 200;
+
+	if (argc > 1)
+		ms = atoi(argv[1]);
+
+	failed |= enforce(ms);
+	failed |= admit();
+
+	printf(1, "\nResults below should be -1: \n");
+	printf(1, "setdeadline(%d, 0, 10) = %d\n", getpid(),
+	       setdeadline(getpid(), 0, 10));
+	printf(1, "setdeadline(%d, 11, 10) = %d\n", getpid(),
+	       setdeadline(getpid(), 11, 10));
+
+	if (failed)
+		printf(1, "TEST FAILED\n");
+	else
+		printf(1, "TEST PASSED\n");
+	exit();
+}
@@ -0,0 +1,128 @@
+/* Written by Roxin Liu */
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "pstat.h"
+
+#define MAXT 8
+
+// Benchmark for gang scheduling: nthreads threads meet at a
+// semaphore barrier every round while as many spinning procs as
+// there are cpus compete for the cpus.  Each round only ends
+// once every thread has run, so a thread descheduled behind a
+// spinner holds up all of its siblings.  The rounds are timed
+// with gang scheduling off and then on.
+
+int nthreads, rounds;
+int mutex, go[MAXT];
+int arrived;
+
+// Wait until all nthreads threads have called barrier().  The
+// last to arrive releases the others through their own
+// semaphores, so a fast thread cannot take a slow one's turn.
+void
+barrier(int self)
+{
+	int i;
+
+	sem_wait(mutex);
+	if (++arrived == nthreads) {
+		arrived = 0;
+		for (i = 0; i < nthreads; i++)
+			if (i != self)
+				sem_post(go[i]);
+		sem_post(mutex);
+		return;
+	}
+	sem_post(mutex);
+	sem_wait(go[self]);
+}
+
+void
+worker(void *arg1, void *arg2)
+{
+	int self = *(int*)arg1;
+	volatile int x;
+	int r;
+
+	for (r = 0; r < rounds; r++) {
+		for (x = 0; x < 20000; x++)
+			;
+		barrier(self);
+	}
+	exit();
+}
+
+// Run the threads to completion and return the ticks it took.
+int
+run(void)
+{
+	int id[MAXT], i, start;
+
+	start = uptime();
+	for (i = 0; i < nthreads; i++) {
+		id[i] = i;
+		if (thread_create(worker, &id[i], 0) < 0) {
+			printf(1, "thread_create failed\n");
+			exit();
+		}
+	}
+	for (i = 0; i < nthreads; i++)
+		thread_join();
+	return uptime() - start;
+}
+
+int main(int argc, char *argv[])
+{
+	struct cpustat cs;
+	int i, pid, nhog, old, off, on;
+	int hogs[NCPU];
+
+	getcpuinfo(&cs);
+	nthreads = cs.ncpu;
+	rounds = 200;
+	if (argc > 1)
+		nthreads = atoi(argv[1]);
+	if (argc > 2)
+		rounds = atoi(argv[2]);
+	if (nthreads < 1 || nthreads > MAXT) {
+		printf(1, "usage: test-gang [nthreads (1-%d)] [rounds]\n", MAXT);
+		exit();
+	}
+
+	if (sem_init(&mutex, 1) < 0) {
+		printf(1, "sem_init failed\n");
+		exit();
+	}
+	for (i = 0; i < nthreads; i++)
+		if (sem_init(&go[i], 0) < 0) {
+			printf(1, "sem_init failed\n");
+			exit();
+		}
+
+	for (nhog = 0; nhog < cs.ncpu; nhog++) {
+		if ((pid = fork()) == 0)
+			for (;;)
+				;
+		hogs[nhog] = pid;
+	}
+
+	old = setgang(0);
+	off = run();
+	setgang(1);
+	on = run();
+	setgang(old);
+
+	for (i = 0; i < nhog; i++)
+		if (hogs[i] > 0)
+			kill(hogs[i]);
+	while (wait() >= 0)
+		;
+
+	printf(1, "%d threads, %d rounds, %d spinners on %d cpus\n",
+	       nthreads, rounds, nhog, cs.ncpu);
+	printf(1, "gang scheduling off: %d ticks\n", off);
+	printf(1, "gang scheduling on:  %d ticks\n", on);
+	exit();
+}
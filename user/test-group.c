@@ -0,0 +1,88 @@
+/* Written by Roxin Liu */
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "pstat.h"
+
+#define GROUP  1
+#define PERIOD 20
+#define NHOG   2   // hogs per cpu, so some wait queued while throttled
+
+struct pstat st;   // too big for the stack
+
+// Spin for ms ticks.
+void
+hog(int ms)
+{
+	int end;
+	volatile int x;
+
+	end = uptime() + ms;
+	while (uptime() < end)
+		for (x = 0; x < 10000; x++)
+			;
+	exit();
+}
+
+// Run NHOG hogs per cpu in a group allowed a quarter of the cpus
+// and check that it got about that.
+int main(int argc, char *argv[])
+{
+	struct cpustat cs;
+	int i, self, quota, usage, limit, failed = 0, ms = 200;
+
+	if (argc > 1)
+		ms = atoi(argv[1]);
+	getcpuinfo(&cs);
+	self = getpid();
+	quota = PERIOD * cs.ncpu / 4;
+	if (setquota(GROUP, quota, PERIOD) < 0) {
+		printf(1, "setquota(%d, %d, %d) failed\n", GROUP, quota, PERIOD);
+		exit();
+	}
+	getprocinfo(&st);
+	usage = st.grp_usage[GROUP];
+
+	// Children inherit the group.
+	setgroup(self, GROUP);
+	for (i = 0; i < NHOG * cs.ncpu; i++)
+		if (fork() == 0)
+			hog(ms);
+	setgroup(self, 0);
+
+	getprocinfo(&st);
+	for (i = 0; i < NPROC; i++)
+		if (st.inuse[i] && st.pid[i] > self && st.group[i] != GROUP) {
+			printf(1, "child %d is in group %d\n", st.pid[i],
+			       st.group[i]);
+			failed = 1;
+		}
+	for (i = 0; i < NHOG * cs.ncpu; i++)
+		wait();
+
+	getprocinfo(&st);
+	usage = st.grp_usage[GROUP] - usage;
+	limit = ms * quota / PERIOD;
+	printf(1, "%d hogs for %d ticks, quota %d/%d: group ran %d ticks "
+	       "(limit %d, %d without), throttled %d times\n", NHOG * cs.ncpu,
+	       ms, quota, PERIOD, usage, limit, ms * cs.ncpu,
+	       st.grp_throttled[GROUP]);
+	// Only the hogs running when the group used up its quota
+	// may run into that tick, one per cpu, in each period.
+	if (usage > limit + (ms / PERIOD + 1) * cs.ncpu || usage < limit / 2 ||
+	    st.grp_throttled[GROUP] == 0)
+		failed = 1;
+	setquota(GROUP, 0, PERIOD);
+
+	printf(1, "\nResults below should be -1: \n");
+	printf(1, "setquota(0, 1, 10) = %d\n", setquota(0, 1, 10));
+	printf(1, "setgroup(%d, %d) = %d\n", self, NGROUP,
+	       setgroup(self, NGROUP));
+
+	if (failed)
+		printf(1, "TEST FAILED\n");
+	else
+		printf(1, "TEST PASSED\n");
+	exit();
+}
@@ -0,0 +1,33 @@
+/* Written by Roxin Liu */
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "pstat.h"
+
+// Print how long each cpu has been idle before and after
+// sleeping, during which every cpu should be halted.
+int main(int argc, char *argv[])
+{
+	struct cpustat before, after;
+	int i, n = 100;
+
+	if (argc > 1)
+		n = atoi(argv[1]);
+
+	if (getcpuinfo(&before) < 0) {
+		printf(1, "getcpuinfo failed\n");
+		exit();
+	}
+	sleep(n);
+	getcpuinfo(&after);
+
+	printf(1, "slept %d ticks on %d cpus\n", n, after.ncpu);
+	for (i = 0; i < after.ncpu; i++)
+		printf(1, "cpu%d: idle ticks %d -> %d\n", i,
+		       before.idle_ticks[i], after.idle_ticks[i]);
+
+	printf(1, "\nResult below should be -1: \n");
+	printf(1, "getcpuinfo(0) = %d\n", getcpuinfo(0));
+	exit();
+}
@@ -0,0 +1,109 @@
+/* Written by Roxin Liu */
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "pstat.h"
+
+#define NROUND 40
+#define BURN   60
+
+// Ticks this process has run.
+int
+ran(void)
+{
+	struct procinfo info;
+	int i, n = 0;
+
+	getprocs(getpid(), &info, 1);
+	for (i = 0; i < 4; i++)
+		n += info.ticks[i];
+	return n;
+}
+
+// Spin for ms ticks.
+void
+hog(int ms)
+{
+	int end;
+	volatile int x;
+
+	end = uptime() + ms;
+	while (uptime() < end)
+		for (x = 0; x < 10000; x++)
+			;
+	exit();
+}
+
+// Run long enough to be demoted to the lowest level, then echo
+// every byte read from in to out until in is closed.
+void
+echo(int in, int out)
+{
+	char c;
+
+	while (ran() < BURN)
+		;
+	write(out, "r", 1);
+	while (read(in, &c, 1) == 1)
+		write(out, &c, 1);
+	exit();
+}
+
+// On a cpu shared with CPU-bound procs, a proc that was demoted to
+// the lowest level echoes bytes back one tick apart.  Woken from
+// the pipe before its slice is used up, it should be queued ahead
+// of the hogs and climb back up the levels.
+int main(int argc, char *argv[])
+{
+	struct cpustat cs;
+	struct procinfo info;
+	int to[2], from[2], self, pid, i, t, worst, total, ms;
+	char c;
+
+	getcpuinfo(&cs);
+	self = getpid();
+	pipe(to);
+	pipe(from);
+	ms = BURN * 3 + NROUND * 2;
+
+	setaffinity(self, 1);
+	if ((pid = fork()) == 0) {
+		close(to[1]);
+		close(from[0]);
+		echo(to[0], from[1]);
+	}
+	for (i = 0; i < 2; i++)
+		if (fork() == 0)
+			hog(ms);
+	setaffinity(self, (1 << cs.ncpu) - 1);
+	close(to[0]);
+	close(from[1]);
+
+	read(from[0], &c, 1);
+	worst = total = 0;
+	for (i = 0; i < NROUND; i++) {
+		sleep(1);
+		t = uptime();
+		write(to[1], "x", 1);
+		read(from[0], &c, 1);
+		t = uptime() - t;
+		total += t;
+		if (t > worst)
+			worst = t;
+	}
+	getprocs(pid, &info, 1);
+	close(to[1]);
+	close(from[0]);
+	for (i = 0; i < 3; i++)
+		wait();
+
+	printf(1, "%d round trips: %d ticks in all, worst %d; echo proc at "
+	       "level %d, boosted %d times\n", NROUND, total, worst,
+	       info.priority, info.ioboosts);
+	if (info.ioboosts < NROUND / 2 || info.priority == 0)
+		printf(1, "TEST FAILED\n");
+	else
+		printf(1, "TEST PASSED\n");
+	exit();
+}
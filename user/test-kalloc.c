@@ -0,0 +1,117 @@
+/* Written by Roxin Liu */
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "pstat.h"
+
+#define NPAGE  64
+#define NROUND 10
+#define PGSIZE 4096
+
+int frames[NPAGE];
+
+// Sum of the first n counters in v.
+uint
+sum(uint *v, int n)
+{
+	uint t = 0;
+
+	while (n-- > 0)
+		t += v[n];
+	return t;
+}
+
+// Grow the heap by NPAGE pages and shrink it back, NROUND times,
+// more pages in all than dump_allocated() remembers.  The last
+// NPAGE pages allocated each round must be distinct pages, and
+// most should come from the cpus' magazines, not the shared pools.
+// New heap pages must read as zeros, though the pages freed by the
+// round before were written to; between rounds the cpus are idle
+// and should zero some pages ahead of time.
+int main(int argc, char *argv[])
+{
+	struct memstat before, after;
+	int i, j, r, n, spread = 0, dirty = 0, failed = 0;
+	uint allocs, hits, frees, spills, zallocs, zhits;
+	char *p;
+
+	getmeminfo(&before);
+
+	for (r = 0; r < NROUND; r++) {
+		sleep(2);
+		if ((p = sbrk(NPAGE * PGSIZE)) == (char*)-1) {
+			printf(1, "sbrk failed\n");
+			exit();
+		}
+		for (i = 0; i < NPAGE * PGSIZE; i++)
+			if (p[i] != 0)
+				dirty++;
+		for (i = 0; i < NPAGE; i++)
+			p[i * PGSIZE] = i + 1;
+		if (dump_allocated(frames, NPAGE) < 0) {
+			printf(1, "dump_allocated failed in round %d\n", r);
+			failed = 1;
+		}
+		for (i = 0; i < NPAGE; i++) {
+			if (frames[i] % PGSIZE) {
+				printf(1, "frame %x is not a page\n", frames[i]);
+				failed = 1;
+			}
+			for (j = 0; j < i; j++)
+				if (frames[i] == frames[j]) {
+					printf(1, "frame %x allocated twice\n", frames[i]);
+					failed = 1;
+				}
+			if (i > 0 && frames[i] != frames[i - 1] + PGSIZE &&
+			    frames[i] != frames[i - 1] - PGSIZE)
+				spread++;
+		}
+		sbrk(-NPAGE * PGSIZE);
+	}
+	getmeminfo(&after);
+	printf(1, "%d pages allocated %d times, %d of %d not next to the one "
+	       "before\n", NPAGE, NROUND, spread, NROUND * (NPAGE - 1));
+
+	allocs = sum(after.allocs, after.ncpu) - sum(before.allocs, before.ncpu);
+	hits = sum(after.hits, after.ncpu) - sum(before.hits, before.ncpu);
+	frees = sum(after.frees, after.ncpu) - sum(before.frees, before.ncpu);
+	spills = sum(after.spills, after.ncpu) - sum(before.spills, before.ncpu);
+	printf(1, "policy %s, %d free pages: %d of %d kallocs from a magazine, "
+	       "%d of %d kfrees spilled, pool lock taken %d times (%d contended)\n",
+	       after.policy, after.freepages, hits, allocs, spills, frees,
+	       after.locks - before.locks, after.contended - before.contended);
+	if (hits * 2 < allocs)
+		failed = 1;
+
+	zallocs = sum(after.zallocs, after.ncpu) - sum(before.zallocs, before.ncpu);
+	zhits = sum(after.zhits, after.ncpu) - sum(before.zhits, before.ncpu);
+	printf(1, "%d of %d zeroed pages zeroed while idle, %d bytes not zero\n",
+	       zhits, zallocs, dirty);
+	if (dirty || zhits == 0)
+		failed = 1;
+
+	// The buddy allocator's free blocks must add up to its free
+	// pages; the fewer of them in big blocks, the more fragmented.
+	printf(1, "buddy allocator: %d free pages, blocks of 2^k pages:",
+	       after.bpages);
+	n = 0;
+	for (i = 0; i <= BUDDYORDER; i++) {
+		printf(1, " %d", after.bfree[i]);
+		n += after.bfree[i] << i;
+	}
+	printf(1, ", %d failed allocations\n", after.bfailed);
+	if (n != after.bpages || n > after.freepages)
+		failed = 1;
+
+	printf(1, "\nResults below should be -1: \n");
+	printf(1, "dump_allocated(frames, -1) = %d\n", dump_allocated(frames, -1));
+	printf(1, "dump_allocated(frames, 100000) = %d\n",
+	       dump_allocated(frames, 100000));
+
+	if (failed)
+		printf(1, "TEST FAILED\n");
+	else
+		printf(1, "TEST PASSED\n");
+	exit();
+}
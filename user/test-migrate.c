@@ -0,0 +1,58 @@
+/* Written by Roxin Liu */
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "pstat.h"
+
+#define PAGE 16
+
+// Run a few children that alternate spinning and sleeping, then
+// print how often each of them and each cpu saw a migration.
+// With cache-affinity dispatch most wakeups should land back on
+// the cpu a child last ran on.
+int main(int argc, char *argv[])
+{
+	struct cpustat before, after;
+	struct procinfo info[PAGE];
+	int i, n, nchild = 4, ms = 200, self, end;
+	volatile int x;
+
+	if (argc > 1)
+		nchild = atoi(argv[1]);
+	if (argc > 2)
+		ms = atoi(argv[2]);
+
+	if (getcpuinfo(&before) < 0) {
+		printf(1, "getcpuinfo failed\n");
+		exit();
+	}
+
+	self = getpid();
+	end = uptime() + ms;
+	for (i = 0; i < nchild; i++) {
+		if (fork() == 0) {
+			while (uptime() < end) {
+				for (x = 0; x < 200000; x++)
+					;
+				sleep(1);
+			}
+			exit();
+		}
+	}
+
+	sleep(ms - ms / 4);
+	n = getprocs(self + 1, info, PAGE);
+	for (i = 0; i < n; i++)
+		printf(1, "pid %d: %d migrations\n",
+		       info[i].pid, info[i].migrations);
+
+	while (wait() >= 0)
+		;
+	getcpuinfo(&after);
+
+	for (i = 0; i < after.ncpu; i++)
+		printf(1, "cpu%d: migrations in %d\n", i,
+		       after.migrations[i] - before.migrations[i]);
+	exit();
+}
@@ -0,0 +1,78 @@
+/* Written by Roxin Liu */
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "pstat.h"
+
+// Print the MLFQ parameters.
+void
+show(struct mlfqparam *mp)
+{
+	int l;
+
+	printf(1, "%d levels, aging %dx, I/O boost up to %d every %d ticks\n",
+	       mp->nlevel, mp->aging, mp->ioboost_top, mp->ioboost_gap);
+	for (l = mp->nlevel - 1; l >= 0; l--)
+		printf(1, "  level %d: slice %d, rr %d\n", l, mp->slice[l],
+		       mp->rr[l]);
+}
+
+// Shrink the MLFQ to two levels at run time, check that new and
+// running procs are kept within them, and put it back.
+int main(int argc, char *argv[])
+{
+	struct mlfqparam old, mp, cur;
+	struct procinfo info;
+	int pid, self, failed = 0;
+
+	self = getpid();
+	setmlfq(&old, 0);
+	show(&old);
+
+	mp = old;
+	mp.nlevel = 2;
+	mp.slice[1] = 4;
+	mp.rr[1] = 2;
+	mp.aging = 5;
+	mp.ioboost_top = 1;
+	if (setmlfq(0, &mp) < 0) {
+		printf(1, "setmlfq failed\n");
+		failed = 1;
+	}
+	setmlfq(&cur, 0);
+	show(&cur);
+	if (cur.nlevel != 2 || cur.slice[1] != 4 || cur.aging != 5)
+		failed = 1;
+
+	if (getprocs(self, &info, 1) != 1 || info.priority > 1) {
+		printf(1, "pid %d left at level %d\n", self, info.priority);
+		failed = 1;
+	}
+	if ((pid = fork()) == 0) {
+		sleep(10);
+		exit();
+	}
+	if (getprocs(pid, &info, 1) != 1 || info.priority != 1) {
+		printf(1, "new pid %d at level %d, expected 1\n", pid,
+		       info.priority);
+		failed = 1;
+	}
+	wait();
+
+	setmlfq(0, &old);
+
+	printf(1, "\nResults below should be -1: \n");
+	mp = old;
+	mp.nlevel = NLAYER + 1;
+	printf(1, "setmlfq with %d levels = %d\n", mp.nlevel, setmlfq(0, &mp));
+	mp = old;
+	mp.rr[0] = 0;
+	printf(1, "setmlfq with a quantum of 0 = %d\n", setmlfq(0, &mp));
+
+	if (failed)
+		printf(1, "TEST FAILED\n");
+	else
+		printf(1, "TEST PASSED\n");
+	exit();
+}
@@ -0,0 +1,116 @@
+/* Written by Roxin Liu */
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "pstat.h"
+
+#define WORK 5
+
+int mutex;
+
+// Ticks this process has run.
+int
+ran(void)
+{
+	struct procinfo info;
+	int i, n = 0;
+
+	getprocs(getpid(), &info, 1);
+	for (i = 0; i < 4; i++)
+		n += info.ticks[i];
+	return n;
+}
+
+// A batch process takes the mutex, tells the parent, and holds it
+// for WORK ticks of its own cpu time.
+void
+holder(int fd)
+{
+	int t;
+
+	setclass(getpid(), SCHED_BATCH, 0);
+	sem_wait(mutex);
+	write(fd, "h", 1);
+	t = ran();
+	while (ran() < t + WORK)
+		;
+	sem_post(mutex);
+	exit();
+}
+
+// Spin for ms ticks.
+void
+hog(int ms)
+{
+	int end;
+	volatile int x;
+
+	end = uptime() + ms;
+	while (uptime() < end)
+		for (x = 0; x < 10000; x++)
+			;
+	exit();
+}
+
+// A real-time process waits for the mutex and reports how long.
+void
+waiter(int fd)
+{
+	int t;
+
+	setclass(getpid(), SCHED_RT, 0);
+	t = uptime();
+	sem_wait(mutex);
+	t = uptime() - t;
+	sem_post(mutex);
+	write(fd, &t, sizeof(t));
+	exit();
+}
+
+// On one cpu, a batch process holds a mutex that a real-time one
+// wants while a normal one keeps the cpu busy.  Without priority
+// inheritance the holder would not run again until the normal one
+// was done; with it, it runs at the waiter's level.
+int main(int argc, char *argv[])
+{
+	struct cpustat cs;
+	int fds[2], self, waited, ms = 200;
+	char c;
+
+	if (argc > 1)
+		ms = atoi(argv[1]);
+	getcpuinfo(&cs);
+	self = getpid();
+	if (sem_init(&mutex, 1) < 0) {
+		printf(1, "sem_init failed\n");
+		exit();
+	}
+	pipe(fds);
+
+	setaffinity(self, 1);
+	if (fork() == 0)
+		holder(fds[1]);
+	read(fds[0], &c, 1);
+	if (fork() == 0)
+		hog(ms);
+	if (fork() == 0)
+		waiter(fds[1]);
+	setaffinity(self, (1 << cs.ncpu) - 1);
+	close(fds[1]);
+
+	read(fds[0], &waited, sizeof(waited));
+	wait();
+	wait();
+	wait();
+	close(fds[0]);
+	sem_destroy(mutex);
+
+	printf(1, "real-time waiter got the mutex after %d ticks "
+	       "(holder needed %d, hog ran %d)\n", waited, WORK, ms);
+	if (waited > ms / 2)
+		printf(1, "TEST FAILED\n");
+	else
+		printf(1, "TEST PASSED\n");
+	exit();
+}
@@ -0,0 +1,64 @@
+/* Written by Roxin Liu */
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "pstat.h"
+
+#define PAGE 16
+
+// Fork more children than NPROC, then walk the process table
+// with getprocs() a page at a time and count them.
+int main(int argc, char *argv[])
+{
+	struct procinfo info[PAGE];
+	int fds[2], i, n, pid, total, forked;
+	char c;
+
+	n = 2 * NPROC;
+	if (argc > 1)
+		n = atoi(argv[1]);
+
+	if (pipe(fds) < 0) {
+		printf(1, "pipe failed\n");
+		exit();
+	}
+
+	// Children block on the pipe until the parent closes it.
+	for (forked = 0; forked < n; forked++) {
+		pid = fork();
+		if (pid < 0)
+			break;
+		if (pid == 0) {
+			close(fds[1]);
+			read(fds[0], &c, 1);
+			exit();
+		}
+	}
+	close(fds[0]);
+
+	total = 0;
+	pid = 0;
+	while ((i = getprocs(pid, info, PAGE)) > 0) {
+		total += i;
+		pid = info[i-1].pid + 1;
+	}
+
+	printf(1, "forked %d children, getprocs() reported %d procs\n",
+	       forked, total);
+	if (forked == n && total > n)
+		printf(1, "TEST PASSED\n");
+	else
+		printf(1, "TEST FAILED\n");
+
+	close(fds[1]);
+	while (wait() >= 0)
+		;
+
+	printf(1, "\nResults below should be -1: \n");
+	printf(1, "getprocs(0, 0, 1) = %d\n", getprocs(0, 0, 1));
+	// A count whose size in bytes wraps around to less than one entry.
+	n = 0xffffffff / sizeof(struct procinfo) + 1;
+	printf(1, "getprocs(0, info, %d) = %d\n", n, getprocs(0, info, n));
+	exit();
+}
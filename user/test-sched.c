@@ -0,0 +1,121 @@
+/* Written by Roxin Liu */
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "pstat.h"
+
+#define NSAMPLE 64
+
+char *policies[] = { "mlfq", "rr", "stride" };
+
+// Spin for ms ticks and report how many loops were done.
+void
+hog(int fd, int ms)
+{
+	int end, loops;
+	volatile int x;
+
+	loops = 0;
+	end = uptime() + ms;
+	while (uptime() < end) {
+		for (x = 0; x < 10000; x++)
+			;
+		loops++;
+	}
+	write(fd, &loops, sizeof(loops));
+	exit();
+}
+
+// Sleep one tick at a time, up to ms times, and report how late
+// each wakeup was.  The report is marked by a negative count so
+// the parent can tell it from the hogs'; each fits in the pipe
+// and so arrives in one piece.
+void
+sleeper(int fd, int ms)
+{
+	int buf[NSAMPLE+1], n, t;
+
+	for (n = 0; n < NSAMPLE && n < ms; n++) {
+		t = uptime();
+		sleep(1);
+		buf[n+1] = uptime() - t - 1;
+	}
+	buf[0] = -n;
+	write(fd, buf, (n + 1) * sizeof(buf[0]));
+	exit();
+}
+
+// Run nhog cpu-bound procs next to one that sleeps a tick at a
+// time under the current policy.  Prints the loops the hogs got
+// through (throughput) and the median and worst wakeup delay of
+// the sleeper (latency), in ticks.
+void
+run(char *name, int nhog, int ms)
+{
+	int fds[2], i, j, n, t, loops, total;
+	int late[NSAMPLE];
+
+	if (setsched(name) < 0) {
+		printf(1, "%s: no such policy\n", name);
+		return;
+	}
+	pipe(fds);
+	for (i = 0; i < nhog; i++)
+		if (fork() == 0)
+			hog(fds[1], ms);
+	if (fork() == 0)
+		sleeper(fds[1], ms);
+	close(fds[1]);
+
+	for (i = 0; i < nhog + 1; i++)
+		wait();
+
+	total = 0;
+	n = 0;
+	while (read(fds[0], &loops, sizeof(loops)) == sizeof(loops)) {
+		if (loops >= 0) {
+			total += loops;
+			continue;
+		}
+		n = -loops;
+		read(fds[0], late, n * sizeof(late[0]));
+	}
+	close(fds[0]);
+
+	// Sort the delays to find the median and the worst.
+	for (i = 1; i < n; i++)
+		for (j = i; j > 0 && late[j-1] > late[j]; j--) {
+			t = late[j];
+			late[j] = late[j-1];
+			late[j-1] = t;
+		}
+	printf(1, "%s: %d loops, wakeup delay median %d max %d ticks\n",
+	       name, total, n ? late[n/2] : 0, n ? late[n-1] : 0);
+}
+
+int main(int argc, char *argv[])
+{
+	struct cpustat cs;
+	int i, nhog, ms = 200;
+
+	getcpuinfo(&cs);
+	nhog = 2 * cs.ncpu;
+	if (argc > 1)
+		nhog = atoi(argv[1]);
+	if (argc > 2)
+		ms = atoi(argv[2]);
+	// Every report has to fit in the pipe (see sleeper()).
+	if (nhog > 32)
+		nhog = 32;
+
+	printf(1, "%d hogs and 1 sleeper for %d ticks on %d cpus\n",
+	       nhog, ms, cs.ncpu);
+	for (i = 0; i < sizeof(policies)/sizeof(policies[0]); i++)
+		run(policies[i], nhog, ms);
+	setsched(cs.policy);
+
+	printf(1, "\nResult below should be -1: \n");
+	printf(1, "setsched(\"none\") = %d\n", setsched("none"));
+	exit();
+}
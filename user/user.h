@@ -3,6 +3,8 @@
 
 struct stat;
 struct pstat;
+struct cpustat;
+struct procinfo;
 enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
 #include "pstat.h"
@@ -41,6 +43,18 @@ int sem_wait(int);
 int sem_post(int);
 int sem_destroy(int);
 int getfilenum(int); 
+int getcpuinfo(struct cpustat*);
+int getprocs(int, struct procinfo*, int);
+int setaffinity(int, int);
+int getaffinity(int);
+int setgang(int);
+int setsched(char*);
+int setclass(int, int, int);
+int setdeadline(int, int, int);
+int setgroup(int, int);
+int setquota(int, int, int);
+int setmlfq(struct mlfqparam*, struct mlfqparam*);
+int getmeminfo(struct memstat*);
 
 // user library functions (ulib.c)
 int stat(char*, struct stat*);